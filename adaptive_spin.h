@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Adaptive spin-then-block waiting
+//
+// Blocking in read() or poll() costs a full scheduler wake-up, often tens of
+// microseconds. A receiver that expects its next message soon can instead
+// poll for it and only go to sleep once a spin budget is used up. The budget
+// follows the time recent waits actually lasted: roughly twice their moving
+// average, capped at a maximum, and zero once waits typically outlast the
+// cap, because then spinning just burns the CPU before the sleep.
+//
+// Modes:
+// - kBlock:    never spin
+// - kAdaptive: spin for the adaptive budget (never on a single CPU, where
+//              the spinner would only keep the sender from running)
+// - kBusyPoll: never sleep, for receivers that own a dedicated core
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace ipc {
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+enum class SpinMode { kBlock, kAdaptive, kBusyPoll };
+
+inline const char *spinModeName(SpinMode m) {
+  switch (m) {
+  case SpinMode::kBlock:
+    return "block";
+  case SpinMode::kAdaptive:
+    return "adaptive";
+  case SpinMode::kBusyPoll:
+    return "busy_poll";
+  }
+  return "unknown";
+}
+
+inline bool spinModeFromName(const std::string &name, SpinMode &mode) {
+  for (SpinMode m :
+       {SpinMode::kBlock, SpinMode::kAdaptive, SpinMode::kBusyPoll}) {
+    if (name == spinModeName(m)) {
+      mode = m;
+      return true;
+    }
+  }
+  return false;
+}
+
+class AdaptiveSpin {
+public:
+  static constexpr uint64_t kUnbounded = UINT64_MAX;
+
+  AdaptiveSpin(SpinMode mode, uint64_t max_spin_ns)
+      : mode_(mode), max_spin_ns_(max_spin_ns) {
+    if (mode_ == SpinMode::kAdaptive && sysconf(_SC_NPROCESSORS_ONLN) <= 1) {
+      mode_ = SpinMode::kBlock;
+    }
+  }
+
+  // How long the next wait should spin before it sleeps.
+  uint64_t budgetNs() const {
+    switch (mode_) {
+    case SpinMode::kBlock:
+      return 0;
+    case SpinMode::kBusyPoll:
+      return kUnbounded;
+    case SpinMode::kAdaptive:
+      break;
+    }
+    if (waits_ == 0) {
+      return max_spin_ns_;
+    }
+    if (average_wait_ns_ > max_spin_ns_) {
+      return 0;
+    }
+    return std::min(max_spin_ns_, 2 * average_wait_ns_ + kSlackNs);
+  }
+
+  // Records a wait that ended with a message after `waited_ns`; `spun` is
+  // true when the message showed up before the spin budget ran out.
+  void record(uint64_t waited_ns, bool spun) {
+    average_wait_ns_ = waits_ == 0 ? waited_ns
+                                   : average_wait_ns_ -
+                                         average_wait_ns_ / kWeight +
+                                         waited_ns / kWeight;
+    ++waits_;
+    (spun ? caught_ : slept_)++;
+  }
+
+  SpinMode mode() const { return mode_; }
+
+  std::string summary() const {
+    std::ostringstream out;
+    out << "receive waits (" << spinModeName(mode_) << "): " << caught_
+        << " caught spinning, " << slept_ << " slept, average wait "
+        << average_wait_ns_ / 1000 << " us" << std::endl;
+    return out.str();
+  }
+
+private:
+  // Moving average weight (1/kWeight per sample) and the extra spin time
+  // on top of twice the average wait
+  static constexpr uint64_t kWeight = 8;
+  static constexpr uint64_t kSlackNs = 1000;
+
+  SpinMode mode_;
+  uint64_t max_spin_ns_;
+  uint64_t average_wait_ns_ = 0;
+  uint64_t waits_ = 0;
+  uint64_t caught_ = 0;
+  uint64_t slept_ = 0;
+};
+
+} // namespace ipc
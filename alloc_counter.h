@@ -0,0 +1,162 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Steady-state allocation counter
+//
+// The per-tensor send and receive paths are meant to run without touching
+// the heap once they are warmed up. Code that must not allocate runs inside
+// a SteadyStateScope; the replacement operator new below counts every
+// allocation made by a thread while such a scope is active, so a run can
+// check that the count stayed at zero.
+//
+// The replacement operators are defined by the one translation unit that
+// includes this header with IPC_DEFINE_ALLOCATION_HOOKS defined. CMake
+// defines it for steady_state_test, and for the sample only with
+// IPC_COUNT_ALLOCATIONS=ON, so normal builds keep the standard allocator.
+// =============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace ipc {
+
+inline thread_local int steady_state_depth = 0;
+inline std::atomic<uint64_t> steady_state_allocations{0};
+
+inline void noteAllocation() {
+  if (steady_state_depth > 0) {
+    steady_state_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Allocations this process made inside a SteadyStateScope so far.
+inline uint64_t steadyStateAllocations() {
+  return steady_state_allocations.load(std::memory_order_relaxed);
+}
+
+// Marks the enclosing block as allocation free; a scope constructed with
+// `armed` false (still warming up) does nothing.
+class SteadyStateScope {
+public:
+  explicit SteadyStateScope(bool armed = true) : armed_(armed) {
+    steady_state_depth += armed_ ? 1 : 0;
+  }
+  ~SteadyStateScope() { steady_state_depth -= armed_ ? 1 : 0; }
+
+  SteadyStateScope(const SteadyStateScope &) = delete;
+  SteadyStateScope &operator=(const SteadyStateScope &) = delete;
+
+private:
+  bool armed_;
+};
+
+// Lifts every enclosing SteadyStateScope for work that is known to allocate,
+// such as building a LibTorch tensor in the middle of the receive path.
+class SteadyStatePause {
+public:
+  SteadyStatePause() : saved_(steady_state_depth) { steady_state_depth = 0; }
+  ~SteadyStatePause() { steady_state_depth = saved_; }
+
+  SteadyStatePause(const SteadyStatePause &) = delete;
+  SteadyStatePause &operator=(const SteadyStatePause &) = delete;
+
+private:
+  int saved_;
+};
+
+inline void *countedAllocate(size_t size, size_t alignment) {
+  noteAllocation();
+  size = size == 0 ? 1 : size;
+  void *ptr = alignment <= alignof(std::max_align_t)
+                  ? std::malloc(size)
+                  : std::aligned_alloc(alignment, (size + alignment - 1) /
+                                                      alignment * alignment);
+  return ptr;
+}
+
+} // namespace ipc
+
+#ifdef IPC_DEFINE_ALLOCATION_HOOKS
+
+void *operator new(std::size_t size) {
+  void *ptr = ipc::countedAllocate(size, alignof(std::max_align_t));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return ipc::countedAllocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return ipc::countedAllocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  void *ptr = ipc::countedAllocate(size, static_cast<size_t>(alignment));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+// GCC does not know these pair with the replacement operator new above
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // IPC_DEFINE_ALLOCATION_HOOKS
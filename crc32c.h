@@ -0,0 +1,216 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// CRC32C (Castagnoli) checksums
+//
+// Host-side payloads can carry a CRC32C so the consumer notices corruption
+// in shared segments. The checksum uses the CPU's CRC instructions where
+// they exist: SSE4.2 on x86-64, picked at run time, and the ARMv8 CRC
+// extension when the compiler targets it. Other CPUs fall back to a table.
+// The instruction has a latency of several cycles, so large buffers are
+// split into three interleaved streams whose results are merged by a
+// table-driven shift; that keeps the checksum close to memcpy speed.
+//
+// crc32cCopy() copies a buffer and checksums it in one pass. It works in
+// chunks small enough to stay in L1, so the checksum reads back bytes the
+// copy has just written instead of going to memory a second time.
+// =============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace ipc {
+
+namespace detail {
+
+inline uint32_t crc32cTable(uint32_t crc, const uint8_t *p, size_t n) {
+  static const struct Table {
+    uint32_t entries[256];
+    Table() {
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+          c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+        }
+        entries[i] = c;
+      }
+    }
+  } table;
+  while (n-- > 0) {
+    crc = table.entries[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+// Bytes per stream of one interleaved block
+constexpr size_t kCrc32cLane = 1024;
+
+// Advances a raw CRC over kCrc32cLane zero bytes. The operation is linear,
+// so it is tabulated per byte of the CRC.
+inline uint32_t crc32cShift(uint32_t crc) {
+  static const struct Table {
+    uint32_t entries[4][256];
+    Table() {
+      static const uint8_t zeros[kCrc32cLane] = {};
+      uint32_t basis[32];
+      for (int bit = 0; bit < 32; ++bit) {
+        basis[bit] = crc32cTable(1u << bit, zeros, kCrc32cLane);
+      }
+      for (int byte = 0; byte < 4; ++byte) {
+        for (uint32_t v = 0; v < 256; ++v) {
+          uint32_t c = 0;
+          for (int bit = 0; bit < 8; ++bit) {
+            c ^= (v >> bit) & 1 ? basis[byte * 8 + bit] : 0;
+          }
+          entries[byte][v] = c;
+        }
+      }
+    }
+  } table;
+  return table.entries[0][crc & 0xff] ^ table.entries[1][(crc >> 8) & 0xff] ^
+         table.entries[2][(crc >> 16) & 0xff] ^ table.entries[3][crc >> 24];
+}
+
+inline uint64_t loadWord(const uint8_t *p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) inline uint32_t
+crc32cHardware(uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 3 * kCrc32cLane; p += 3 * kCrc32cLane, n -= 3 * kCrc32cLane) {
+    uint64_t c0 = crc, c1 = 0, c2 = 0;
+    for (size_t k = 0; k < kCrc32cLane; k += 8) {
+      c0 = _mm_crc32_u64(c0, loadWord(p + k));
+      c1 = _mm_crc32_u64(c1, loadWord(p + kCrc32cLane + k));
+      c2 = _mm_crc32_u64(c2, loadWord(p + 2 * kCrc32cLane + k));
+    }
+    crc = crc32cShift(crc32cShift(static_cast<uint32_t>(c0)) ^
+                      static_cast<uint32_t>(c1)) ^
+          static_cast<uint32_t>(c2);
+  }
+  uint64_t c = crc;
+  for (; n >= 8; p += 8, n -= 8) {
+    c = _mm_crc32_u64(c, loadWord(p));
+  }
+  crc = static_cast<uint32_t>(c);
+  for (; n > 0; ++p, --n) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+
+inline bool crc32cHardwareAvailable() {
+  static const bool available = __builtin_cpu_supports("sse4.2");
+  return available;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+inline uint32_t crc32cHardware(uint32_t crc, const uint8_t *p, size_t n) {
+  for (; n >= 3 * kCrc32cLane; p += 3 * kCrc32cLane, n -= 3 * kCrc32cLane) {
+    uint32_t c0 = crc, c1 = 0, c2 = 0;
+    for (size_t k = 0; k < kCrc32cLane; k += 8) {
+      c0 = __crc32cd(c0, loadWord(p + k));
+      c1 = __crc32cd(c1, loadWord(p + kCrc32cLane + k));
+      c2 = __crc32cd(c2, loadWord(p + 2 * kCrc32cLane + k));
+    }
+    crc = crc32cShift(crc32cShift(c0) ^ c1) ^ c2;
+  }
+  for (; n >= 8; p += 8, n -= 8) {
+    crc = __crc32cd(crc, loadWord(p));
+  }
+  for (; n > 0; ++p, --n) {
+    crc = __crc32cb(crc, *p);
+  }
+  return crc;
+}
+
+inline bool crc32cHardwareAvailable() { return true; }
+#else
+inline uint32_t crc32cHardware(uint32_t crc, const uint8_t *p, size_t n) {
+  return crc32cTable(crc, p, n);
+}
+
+inline bool crc32cHardwareAvailable() { return false; }
+#endif
+
+// Raw update without the initial and final inversion
+inline uint32_t crc32cUpdate(uint32_t crc, const void *data, size_t n) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  return crc32cHardwareAvailable() ? crc32cHardware(crc, p, n)
+                                   : crc32cTable(crc, p, n);
+}
+
+} // namespace detail
+
+// Chunk size of crc32cCopy(): four interleaved blocks, well inside a
+// typical 32-48 KiB L1 cache
+constexpr size_t kCrc32cCopyChunk = 4 * 3 * detail::kCrc32cLane;
+
+// CRC32C of `n` bytes. Pass a previous result as `crc` to continue it.
+inline uint32_t crc32c(const void *data, size_t n, uint32_t crc = 0) {
+  return ~detail::crc32cUpdate(~crc, data, n);
+}
+
+// Copies `n` bytes from `src` to `dst` and returns their CRC32C.
+inline uint32_t crc32cCopy(void *dst, const void *src, size_t n,
+                           uint32_t crc = 0) {
+  char *out = static_cast<char *>(dst);
+  const char *in = static_cast<const char *>(src);
+  crc = ~crc;
+  while (n > 0) {
+    const size_t chunk = n < kCrc32cCopyChunk ? n : kCrc32cCopyChunk;
+    memcpy(out, in, chunk);
+    crc = detail::crc32cUpdate(crc, out, chunk);
+    out += chunk;
+    in += chunk;
+    n -= chunk;
+  }
+  return ~crc;
+}
+
+// Name of the implementation in use, for start-up logs
+inline const char *crc32cImplementation() {
+  if (!detail::crc32cHardwareAvailable()) {
+    return "table";
+  }
+#if defined(__x86_64__)
+  return "sse4.2";
+#else
+  return "armv8-crc";
+#endif
+}
+
+} // namespace ipc
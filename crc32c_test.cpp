@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// CRC32C test
+//
+// Checks crc32c.h against the RFC 3720 test vectors and a bit-at-a-time
+// reference. Lengths around multiples of 3 * kCrc32cLane go through the
+// three interleaved streams and the crc32cShift() merge, with a tail of odd
+// bytes after them; the hardware and table paths must agree on every one.
+// =============================================================================
+
+#include "crc32c.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kStride = 3 * ipc::detail::kCrc32cLane;
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+// CRC32C one bit at a time, sharing no code with crc32c.h
+uint32_t reference(const uint8_t *p, size_t n) {
+  uint32_t crc = ~0u;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= p[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+std::vector<uint8_t> pattern(size_t n) {
+  std::vector<uint8_t> bytes(n);
+  uint32_t x = 0x9e3779b9u;
+  for (uint8_t &b : bytes) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    b = static_cast<uint8_t>(x);
+  }
+  return bytes;
+}
+
+// Lengths that end just before, on and just after each interleaved stride,
+// and a few with a tail that is not a whole word
+std::vector<size_t> lengths() {
+  std::vector<size_t> out = {0, 1, 7, 8, 9, 63, 1024, 3000};
+  for (size_t strides = 1; strides <= 3; ++strides) {
+    for (int delta : {-8, -1, 0, 1, 5, 8}) {
+      out.push_back(strides * kStride + delta);
+    }
+  }
+  out.push_back(ipc::kCrc32cCopyChunk + 3);
+  out.push_back(5 * ipc::kCrc32cCopyChunk / 2);
+  return out;
+}
+
+void testVectors() {
+  const std::string check = "123456789";
+  expect(ipc::crc32c(check.data(), check.size()) == 0xe3069283u,
+         "\"123456789\" checks to e3069283");
+
+  // RFC 3720 appendix B.4
+  uint8_t bytes[32];
+  memset(bytes, 0, sizeof(bytes));
+  expect(ipc::crc32c(bytes, sizeof(bytes)) == 0x8a9136aau, "32 zero bytes");
+  memset(bytes, 0xff, sizeof(bytes));
+  expect(ipc::crc32c(bytes, sizeof(bytes)) == 0x62a8ab43u, "32 0xff bytes");
+  for (int i = 0; i < 32; ++i) {
+    bytes[i] = static_cast<uint8_t>(i);
+  }
+  expect(ipc::crc32c(bytes, sizeof(bytes)) == 0x46dd794eu,
+         "32 incrementing bytes");
+  for (int i = 0; i < 32; ++i) {
+    bytes[i] = static_cast<uint8_t>(31 - i);
+  }
+  expect(ipc::crc32c(bytes, sizeof(bytes)) == 0x113fdb5cu,
+         "32 decrementing bytes");
+}
+
+void testLengths() {
+  const std::vector<uint8_t> data = pattern(3 * ipc::kCrc32cCopyChunk);
+  const bool hardware = ipc::detail::crc32cHardwareAvailable();
+  for (size_t n : lengths()) {
+    const uint32_t want = reference(data.data(), n);
+    char what[96];
+    snprintf(what, sizeof(what), "crc32c of %zu bytes", n);
+    expect(ipc::crc32c(data.data(), n) == want, what);
+
+    snprintf(what, sizeof(what), "table path over %zu bytes", n);
+    expect(~ipc::detail::crc32cTable(~0u, data.data(), n) == want, what);
+    if (hardware) {
+      snprintf(what, sizeof(what), "hardware path over %zu bytes", n);
+      expect(~ipc::detail::crc32cHardware(~0u, data.data(), n) == want, what);
+    }
+
+    // Continuing a checksum across a split that is not stride aligned
+    const size_t head = n / 3;
+    snprintf(what, sizeof(what), "crc32c continued over %zu bytes", n);
+    expect(ipc::crc32c(data.data() + head, n - head,
+                       ipc::crc32c(data.data(), head)) == want,
+           what);
+
+    std::vector<uint8_t> copy(n + 1, 0xa5);
+    snprintf(what, sizeof(what), "crc32cCopy of %zu bytes", n);
+    expect(ipc::crc32cCopy(copy.data(), data.data(), n) == want &&
+               std::equal(data.begin(), data.begin() + n, copy.begin()) &&
+               copy[n] == 0xa5,
+           what);
+  }
+}
+
+} // namespace
+
+int main() {
+  try {
+    printf("crc32c implementation: %s\n", ipc::crc32cImplementation());
+    testVectors();
+    testLengths();
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "crc32c_test: %s\n", e.what());
+    return 2;
+  }
+}
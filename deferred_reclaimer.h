@@ -0,0 +1,256 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Deferred unmapping
+//
+// Tensor deleters run on whatever thread drops the last reference, which is
+// often the inference loop. Instead of calling cudaIpcCloseMemHandle there,
+// deleters push a CloseRequest into a bounded lock-free queue. A background
+// reclaimer thread drains the queue in batches, performs the closes and hands
+// the released allocations to a callback in one go, so the producer receives
+// one release notification per batch.
+//
+// An optional poll callback runs on every pass of the reclaimer loop. It is
+// how deferred work with its own timing, such as unmapping entries whose
+// epoch grace period has elapsed, joins the same batches.
+// =============================================================================
+
+#pragma once
+
+#include "ipc_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ipc {
+
+struct CloseRequest {
+  void *ptr;
+  int32_t index; // Released with a count of one; negative to skip
+  uint8_t kind;  // Caller-defined, e.g. the Transport the mapping came from
+  uint64_t tag;  // Caller-defined, e.g. the key `ptr` is looked up by
+};
+
+// Bounded multi-producer queue (Vyukov). Push and pop are lock-free; push
+// fails instead of blocking when the queue is full.
+template <typename T> class BoundedMpmcQueue {
+public:
+  explicit BoundedMpmcQueue(size_t capacity_pow2)
+      : mask_(capacity_pow2 - 1), cells_(new Cell[capacity_pow2]) {
+    for (size_t i = 0; i < capacity_pow2; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T &value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool pop(T &value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          value = cell.value;
+          cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+class DeferredReclaimer {
+public:
+  using CloseFn = std::function<void(const CloseRequest &)>;
+  using ReleaseFn =
+      std::function<void(const ReleaseRecord *records, size_t count)>;
+  // Appends released allocations; returns true while more work is pending.
+  using PollFn = std::function<bool(std::vector<ReleaseRecord> &released)>;
+
+  static constexpr size_t kMaxBatch = 256;
+  static_assert(kMaxBatch <= kMaxReleaseBatch,
+                "a batch must fit one atomic pipe write");
+
+  // `init` runs once on the reclaimer thread before anything else, e.g. to
+  // bind the CUDA device.
+  DeferredReclaimer(CloseFn close, ReleaseFn release,
+                    std::function<void()> init = {}, PollFn poll = {},
+                    size_t capacity_pow2 = 4096)
+      : close_(std::move(close)), release_(std::move(release)),
+        poll_(std::move(poll)), queue_(capacity_pow2) {
+    thread_ = std::thread([this, init] {
+      if (init) {
+        init();
+      }
+      run();
+    });
+  }
+
+  DeferredReclaimer(const DeferredReclaimer &) = delete;
+  DeferredReclaimer &operator=(const DeferredReclaimer &) = delete;
+
+  ~DeferredReclaimer() {
+    stop_.store(true, std::memory_order_release);
+    wake();
+    thread_.join();
+  }
+
+  // Called from tensor deleters. Only falls back to waiting when the queue
+  // is full.
+  void enqueue(const CloseRequest &request) {
+    enqueued_.fetch_add(1, std::memory_order_relaxed);
+    while (!queue_.push(request)) {
+      wake();
+      std::this_thread::yield();
+    }
+    if (idle_.load(std::memory_order_acquire)) {
+      wake();
+    }
+  }
+
+  // Blocks until every request enqueued before the call has been closed and
+  // reported, and the poll callback has no pending work left.
+  void flush() {
+    uint64_t target = enqueued_.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_cv_.notify_one();
+    done_cv_.wait(lock, [&] {
+      return completed_.load(std::memory_order_acquire) >= target &&
+             !poll_pending_.load(std::memory_order_acquire);
+    });
+  }
+
+  uint64_t completed() const {
+    return completed_.load(std::memory_order_relaxed);
+  }
+
+private:
+  void wake() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_cv_.notify_one();
+  }
+
+  void run() {
+    std::vector<ReleaseRecord> released;
+    released.reserve(kMaxBatch);
+    for (;;) {
+      size_t n = 0;
+      CloseRequest request;
+      while (n < kMaxBatch && queue_.pop(request)) {
+        close_(request);
+        if (request.index >= 0) {
+          released.push_back({request.index, 1});
+        }
+        ++n;
+      }
+      bool pending = poll_ && poll_(released);
+      for (size_t i = 0; i < released.size(); i += kMaxBatch) {
+        size_t count = std::min(kMaxBatch, released.size() - i);
+        release_(released.data() + i, count);
+      }
+      released.clear();
+      completed_.fetch_add(n, std::memory_order_release);
+      poll_pending_.store(pending, std::memory_order_release);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_cv_.notify_all();
+      }
+      if (n > 0) {
+        continue;
+      }
+      if (stop_.load(std::memory_order_acquire) && !pending) {
+        return;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      idle_.store(true, std::memory_order_release);
+      // The timeout covers a push that raced with going idle, and paces
+      // polling while deferred work is waiting for its grace period
+      wake_cv_.wait_for(lock, pending ? std::chrono::microseconds(100)
+                                      : std::chrono::microseconds(2000));
+      idle_.store(false, std::memory_order_release);
+    }
+  }
+
+  CloseFn close_;
+  ReleaseFn release_;
+  PollFn poll_;
+  BoundedMpmcQueue<CloseRequest> queue_;
+  std::atomic<uint64_t> enqueued_{0};
+  std::atomic<uint64_t> completed_{0};
+  std::atomic<bool> poll_pending_{false};
+  std::atomic<bool> idle_{false};
+  std::atomic<bool> stop_{false};
+  std::mutex mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable done_cv_;
+  std::thread thread_;
+};
+
+} // namespace ipc
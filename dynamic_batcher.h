@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Dynamic batching policy
+//
+// Accumulates items until either `max_batch` items are queued or the oldest
+// queued item has waited `max_delay_ns`, trading a bounded amount of latency
+// for larger batches. The batcher only decides when to emit; collating the
+// items into one model input is up to the caller.
+// =============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ipc {
+
+template <typename T> class DynamicBatcher {
+public:
+  DynamicBatcher(size_t max_batch, uint64_t max_delay_ns)
+      : max_batch_(max_batch == 0 ? 1 : max_batch),
+        max_delay_ns_(max_delay_ns) {
+    items_.reserve(max_batch_);
+  }
+
+  // Queues an item that arrived at `arrival_ns`. Returns true when the batch
+  // is due at `now_ns`, full or past its deadline, and should be emitted.
+  // Checking on every add bounds the wait of the oldest item even when the
+  // caller never goes idle.
+  bool add(T item, uint64_t arrival_ns, uint64_t now_ns) {
+    if (items_.empty() || arrival_ns < first_arrival_ns_) {
+      first_arrival_ns_ = arrival_ns;
+    }
+    items_.push_back(std::move(item));
+    return due(now_ns);
+  }
+
+  bool empty() const { return items_.empty(); }
+  size_t size() const { return items_.size(); }
+  size_t maxBatch() const { return max_batch_; }
+
+  // Absolute time by which the current batch must be emitted: the deadline
+  // of its oldest item, which need not be the first one added.
+  uint64_t deadlineNs() const { return first_arrival_ns_ + max_delay_ns_; }
+
+  bool due(uint64_t now_ns) const {
+    return !items_.empty() &&
+           (items_.size() >= max_batch_ || now_ns >= deadlineNs());
+  }
+
+  // Nanoseconds until the deadline; zero when already due, -1 when empty.
+  int64_t timeoutNs(uint64_t now_ns) const {
+    if (items_.empty()) {
+      return -1;
+    }
+    return now_ns >= deadlineNs() ? 0
+                                  : static_cast<int64_t>(deadlineNs() - now_ns);
+  }
+
+  // Hands out the queued items and starts a new batch. The vector is swapped
+  // with `out`, so passing the previous batch back in reuses its storage.
+  void take(std::vector<T> &out) {
+    out.clear();
+    out.swap(items_);
+    items_.reserve(max_batch_);
+  }
+
+private:
+  size_t max_batch_;
+  uint64_t max_delay_ns_;
+  uint64_t first_arrival_ns_ = 0;
+  std::vector<T> items_;
+};
+
+} // namespace ipc
@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Dynamic batcher test
+//
+// Drives the batcher the way the consumer's receive loop does, on a simulated
+// clock: descriptors come off the lanes with a read time, the tenant
+// scheduler hands them out, and each processed one is added to the batcher.
+// The stream never lets the scheduler run dry, so the idle wait that also
+// emits partial batches is never reached; the deadline must still hold.
+// =============================================================================
+
+#include "dynamic_batcher.h"
+#include "tenant_scheduler.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMaxBatch = 64;
+constexpr uint64_t kMaxDelayNs = 1000000;
+constexpr uint64_t kProcessNs = 30000; // Per tensor, so 64 take ~2 ms
+constexpr int kTensors = 2000;
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+struct Item {
+  int index;
+  uint64_t read_ns;
+};
+
+// A backlog of two tenants that is topped up by one descriptor per processed
+// one. Deficit round robin alternates the tenants, so tensors are added out
+// of arrival order. Returns the largest wait of a batch's oldest tensor.
+uint64_t neverIdleStream(size_t &partial_batches, size_t &tensors_out) {
+  ipc::DynamicBatcher<Item> batcher(kMaxBatch, kMaxDelayNs);
+  ipc::TenantScheduler<Item> scheduler(ipc::SchedulePolicy::kDrr, 4096,
+                                       ipc::TenantQuota());
+  uint64_t now_ns = 0;
+  int next = 0;
+  auto arrive = [&] {
+    // Tenant 0 sends bursts of three, tenant 1 single tensors
+    const uint32_t tenant = next % 4 == 3 ? 1 : 0;
+    scheduler.push(tenant, 0, 4096, 0, Item{next++, now_ns});
+  };
+  for (int k = 0; k < 16; ++k) {
+    arrive();
+  }
+
+  std::vector<Item> batch;
+  uint64_t worst_wait_ns = 0;
+  auto emit = [&] {
+    batcher.take(batch);
+    uint64_t oldest_ns = batch.front().read_ns;
+    for (const Item &item : batch) {
+      oldest_ns = item.read_ns < oldest_ns ? item.read_ns : oldest_ns;
+    }
+    worst_wait_ns = std::max(worst_wait_ns, now_ns - oldest_ns);
+    partial_batches += batch.size() < kMaxBatch ? 1 : 0;
+    tensors_out += batch.size();
+  };
+
+  Item item;
+  uint32_t tenant = 0;
+  while (scheduler.pop(item, tenant)) {
+    now_ns += kProcessNs;
+    scheduler.release(tenant, 4096);
+    if (next < kTensors) {
+      arrive();
+    }
+    if (batcher.add(item, item.read_ns, now_ns)) {
+      emit();
+    }
+    if (next < kTensors && scheduler.empty()) {
+      throw std::runtime_error("stream went idle");
+    }
+  }
+  if (!batcher.empty()) {
+    emit();
+  }
+  return worst_wait_ns;
+}
+
+void testFullBatch() {
+  ipc::DynamicBatcher<int> batcher(4, kMaxDelayNs);
+  bool due = false;
+  for (int k = 0; k < 4; ++k) {
+    expect(!due, "a batch is not due before it is full");
+    due = batcher.add(k, 0, 1);
+  }
+  expect(due, "a full batch is due before its deadline");
+}
+
+void testOldestArrival() {
+  ipc::DynamicBatcher<int> batcher(kMaxBatch, kMaxDelayNs);
+  expect(!batcher.add(1, 500000, 600000), "a fresh tensor is not due");
+  expect(batcher.deadlineNs() == 500000 + kMaxDelayNs,
+         "the deadline counts from the first arrival");
+  expect(batcher.add(2, 100000, 1100000),
+         "an older tensor added later moves the deadline forward");
+  expect(batcher.timeoutNs(1100000) == 0, "a due batch has no time left");
+}
+
+} // namespace
+
+int main() {
+  try {
+    testFullBatch();
+    testOldestArrival();
+    size_t partial_batches = 0;
+    size_t tensors_out = 0;
+    const uint64_t worst_wait_ns =
+        neverIdleStream(partial_batches, tensors_out);
+    printf("never idle stream: %zu partial batches, oldest tensor waited up "
+           "to %.0f us\n",
+           partial_batches, worst_wait_ns / 1e3);
+    expect(tensors_out == static_cast<size_t>(kTensors),
+           "every tensor comes out in a batch");
+    expect(partial_batches > 1, "partial batches are emitted under load");
+    // The deadline is checked after each processed tensor, so the oldest one
+    // waits at most one processing step past it
+    expect(worst_wait_ns <= kMaxDelayNs + kProcessNs,
+           "the oldest tensor waits no longer than the deadline");
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "dynamic_batcher_test: %s\n", e.what());
+    return 2;
+  }
+}
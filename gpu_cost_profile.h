@@ -0,0 +1,215 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// GPU cost profile
+//
+// Per-operation costs of the CUDA calls the sample makes: a fixed latency
+// and, for copies, a bandwidth. A CUDA run can capture them from the calls
+// it actually makes; the host backend can then inject the same costs so
+// benchmarks on CPU-only machines keep realistic ratios between allocating,
+// exporting, mapping and copying.
+//
+// Profiles are text files with one `op latency_ns [GB/s]` line per
+// operation; `#` starts a comment and later lines override earlier ones.
+// =============================================================================
+
+#pragma once
+
+#include "monotonic_clock.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace ipc {
+
+class GpuCostProfile {
+public:
+  enum Op {
+    kMalloc,
+    kFree,
+    kGetHandle,
+    kOpenHandle,
+    kCloseHandle,
+    kCopyH2D,
+    kCopyD2H,
+    kNumOps
+  };
+
+  static const char *opName(Op op) {
+    static const char *const names[kNumOps] = {
+        "malloc",       "free",     "get_handle", "open_handle",
+        "close_handle", "copy_h2d", "copy_d2h"};
+    return names[op];
+  }
+
+  GpuCostProfile() = default;
+  GpuCostProfile(const GpuCostProfile &) = delete;
+  GpuCostProfile &operator=(const GpuCostProfile &) = delete;
+
+  void load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+      throw std::runtime_error("Cannot open GPU cost profile " + path + ": " +
+                               strerror(errno));
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      line = line.substr(0, line.find('#'));
+      std::istringstream fields(line);
+      std::string name;
+      if (!(fields >> name)) {
+        continue;
+      }
+      Op op = kNumOps;
+      for (int k = 0; k < kNumOps; ++k) {
+        if (name == opName(static_cast<Op>(k))) {
+          op = static_cast<Op>(k);
+        }
+      }
+      double latency_ns = 0, gbps = 0;
+      if (op == kNumOps || !(fields >> latency_ns) || latency_ns < 0) {
+        throw std::runtime_error("Invalid GPU cost profile line: " + line);
+      }
+      fields >> gbps;
+      latency_ns_[op] = static_cast<uint64_t>(latency_ns);
+      bytes_per_ns_[op] = gbps > 0 ? gbps : 0; // 1 GB/s is 1 byte/ns
+      enabled_ = true;
+    }
+  }
+
+  bool enabled() const { return enabled_; }
+
+  // Modelled cost of `op` on `nbytes`.
+  uint64_t costNs(Op op, uint64_t nbytes = 0) const {
+    uint64_t ns = latency_ns_[op];
+    if (bytes_per_ns_[op] > 0) {
+      ns += static_cast<uint64_t>(nbytes / bytes_per_ns_[op]);
+    }
+    return ns;
+  }
+
+  // Stalls the calling thread for the modelled cost of `op`.
+  void inject(Op op, uint64_t nbytes = 0) const {
+    if (enabled_) {
+      stall(costNs(op, nbytes));
+    }
+  }
+
+  // Capture side: accumulates the measured cost of real calls. Safe to call
+  // from several threads.
+  void startCapture() { capturing_ = true; }
+  bool capturing() const { return capturing_; }
+
+  void record(Op op, uint64_t ns, uint64_t nbytes = 0) {
+    if (!capturing_) {
+      return;
+    }
+    Samples &s = samples_[op];
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    s.total_bytes.fetch_add(nbytes, std::memory_order_relaxed);
+    uint64_t min = s.min_ns.load(std::memory_order_relaxed);
+    while (ns < min && !s.min_ns.compare_exchange_weak(
+                           min, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Appends the captured operations to a profile file. Producer and
+  // consumer each capture the calls they make and append to the same file.
+  void appendCaptured(const std::string &path) const {
+    std::string text;
+    for (int k = 0; k < kNumOps; ++k) {
+      const Samples &s = samples_[k];
+      const uint64_t count = s.count.load(std::memory_order_relaxed);
+      if (count == 0) {
+        continue;
+      }
+      const uint64_t total_ns = s.total_ns.load(std::memory_order_relaxed);
+      const uint64_t total_bytes =
+          s.total_bytes.load(std::memory_order_relaxed);
+      char line[128];
+      if (total_bytes == 0) {
+        snprintf(line, sizeof(line), "%s %llu\n", opName(static_cast<Op>(k)),
+                 static_cast<unsigned long long>(total_ns / count));
+      } else {
+        // The fastest call approximates the fixed latency; the rest of the
+        // time is spent moving bytes
+        const uint64_t latency = s.min_ns.load(std::memory_order_relaxed);
+        const uint64_t transfer_ns =
+            total_ns > latency * count ? total_ns - latency * count : 1;
+        snprintf(line, sizeof(line), "%s %llu %.3f\n",
+                 opName(static_cast<Op>(k)),
+                 static_cast<unsigned long long>(latency),
+                 static_cast<double>(total_bytes) / transfer_ns);
+      }
+      text += line;
+    }
+    FILE *file = fopen(path.c_str(), "a");
+    if (file == nullptr) {
+      throw std::runtime_error("Cannot append to GPU cost profile " + path +
+                               ": " + strerror(errno));
+    }
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+  }
+
+private:
+  struct Samples {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> total_bytes{0};
+    std::atomic<uint64_t> min_ns{UINT64_MAX};
+  };
+
+  // Sleeps for the bulk of long stalls and spins the remainder, since timer
+  // slack would swamp microsecond-scale costs.
+  static void stall(uint64_t ns) {
+    constexpr uint64_t kSpinNs = 100000;
+    const uint64_t deadline = monotonicNs() + ns;
+    if (ns > kSpinNs) {
+      struct timespec ts;
+      ts.tv_sec = (ns - kSpinNs) / 1000000000;
+      ts.tv_nsec = (ns - kSpinNs) % 1000000000;
+      while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+      }
+    }
+    while (monotonicNs() < deadline) {
+    }
+  }
+
+  bool enabled_ = false;
+  bool capturing_ = false;
+  uint64_t latency_ns_[kNumOps] = {};
+  double bytes_per_ns_[kNumOps] = {};
+  Samples samples_[kNumOps];
+};
+
+} // namespace ipc
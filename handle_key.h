@@ -0,0 +1,278 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Fixed-size IPC handle keys
+//
+// - hashHandleBytes / handleBytesEqual: a word-wise hash and a SIMD equality
+//   check for 64-byte handles (cudaIpcMemHandle_t or HostIpcHandle), used as
+//   the key functions of the mapping table
+// - HandleKey with HandleKeyHash and HandleKeyEqual: the same functions for
+//   standard containers keyed by handle
+// - Table-driven hex and base64 codecs for logging and text transports
+// =============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace ipc {
+
+constexpr size_t kHandleSize = 64;
+
+// Compares two 64-byte blocks. AVX2 needs -mavx2 (or -march=native); SSE2 is
+// always available on x86-64.
+inline bool handleBytesEqual(const void *a, const void *b) {
+  const char *pa = static_cast<const char *>(a);
+  const char *pb = static_cast<const char *>(b);
+#if defined(__AVX2__)
+  __m256i d0 = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb)));
+  __m256i d1 = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa + 32)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb + 32)));
+  __m256i d = _mm256_or_si256(d0, d1);
+  return _mm256_testz_si256(d, d) != 0;
+#elif defined(__SSE2__)
+  __m128i d = _mm_setzero_si128();
+  for (int i = 0; i < 64; i += 16) {
+    d = _mm_or_si128(
+        d, _mm_xor_si128(
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + i)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + i))));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(d, _mm_setzero_si128())) == 0xFFFF;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t d = vdupq_n_u8(0);
+  for (int i = 0; i < 64; i += 16) {
+    d = vorrq_u8(d, veorq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(pa + i)),
+                             vld1q_u8(reinterpret_cast<const uint8_t *>(pb + i))));
+  }
+  return vmaxvq_u8(d) == 0;
+#else
+  return memcmp(pa, pb, kHandleSize) == 0;
+#endif
+}
+
+// Hashes 64 bytes as eight 64-bit words with 128-bit multiply folding.
+inline uint64_t hashHandleBytes(const void *data) {
+  constexpr uint64_t kSecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                   0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+  uint64_t w[8];
+  memcpy(w, data, kHandleSize);
+  auto mum = [](uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+  };
+  uint64_t h = mum(w[0] ^ kSecret[0], w[1] ^ kSecret[1]) ^
+               mum(w[2] ^ kSecret[2], w[3] ^ kSecret[3]);
+  h ^= mum(w[4] ^ kSecret[1], w[5] ^ kSecret[2]) ^
+       mum(w[6] ^ kSecret[3], w[7] ^ kSecret[0]);
+  return mum(h ^ kSecret[0], kHandleSize ^ kSecret[1]);
+}
+
+// A handle by value, e.g. for
+// std::unordered_map<HandleKey, T, HandleKeyHash, HandleKeyEqual>
+struct HandleKey {
+  uint8_t bytes[kHandleSize];
+
+  HandleKey() = default;
+  explicit HandleKey(const void *handle) { memcpy(bytes, handle, kHandleSize); }
+};
+
+struct HandleKeyHash {
+  size_t operator()(const HandleKey &key) const {
+    return hashHandleBytes(key.bytes);
+  }
+};
+
+struct HandleKeyEqual {
+  bool operator()(const HandleKey &a, const HandleKey &b) const {
+    return handleBytesEqual(a.bytes, b.bytes);
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Text codecs
+// -----------------------------------------------------------------------------
+
+namespace detail {
+
+struct HexTables {
+  char encode[256][2];
+  int8_t decode[256];
+
+  HexTables() {
+    const char *digits = "0123456789ABCDEF";
+    for (int i = 0; i < 256; ++i) {
+      encode[i][0] = digits[i >> 4];
+      encode[i][1] = digits[i & 15];
+      decode[i] = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+      decode['0' + i] = static_cast<int8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+      decode['A' + i] = static_cast<int8_t>(10 + i);
+      decode['a' + i] = static_cast<int8_t>(10 + i);
+    }
+  }
+};
+
+struct Base64Tables {
+  const char *encode =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  int8_t decode[256];
+
+  Base64Tables() {
+    for (int i = 0; i < 256; ++i) {
+      decode[i] = -1;
+    }
+    for (int i = 0; i < 64; ++i) {
+      decode[static_cast<uint8_t>(encode[i])] = static_cast<int8_t>(i);
+    }
+  }
+};
+
+inline const HexTables &hexTables() {
+  static const HexTables tables;
+  return tables;
+}
+
+inline const Base64Tables &base64Tables() {
+  static const Base64Tables tables;
+  return tables;
+}
+
+} // namespace detail
+
+// Writes 2 * size upper-case hex digits to `out`.
+inline void hexEncode(const void *data, size_t size, char *out) {
+  const auto &t = detail::hexTables();
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    memcpy(out + 2 * i, t.encode[p[i]], 2);
+  }
+}
+
+inline std::string hexEncode(const void *data, size_t size) {
+  std::string out(2 * size, '\0');
+  hexEncode(data, size, &out[0]);
+  return out;
+}
+
+// Decodes exactly `size` bytes; accepts an optional "0x" prefix.
+inline bool hexDecode(const std::string &text, void *out, size_t size) {
+  const auto &t = detail::hexTables();
+  size_t offset = text.compare(0, 2, "0x") == 0 ? 2 : 0;
+  if (text.size() - offset != 2 * size) {
+    return false;
+  }
+  uint8_t *p = static_cast<uint8_t *>(out);
+  for (size_t i = 0; i < size; ++i) {
+    int hi = t.decode[static_cast<uint8_t>(text[offset + 2 * i])];
+    int lo = t.decode[static_cast<uint8_t>(text[offset + 2 * i + 1])];
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    p[i] = static_cast<uint8_t>((hi << 4) | lo);
+  }
+  return true;
+}
+
+inline std::string base64Encode(const void *data, size_t size) {
+  const char *enc = detail::base64Tables().encode;
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  std::string out;
+  out.reserve((size + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    uint32_t v = (p[i] << 16) | (p[i + 1] << 8) | p[i + 2];
+    out += enc[v >> 18];
+    out += enc[(v >> 12) & 63];
+    out += enc[(v >> 6) & 63];
+    out += enc[v & 63];
+  }
+  if (i < size) {
+    uint32_t v = p[i] << 16;
+    if (i + 1 < size) {
+      v |= p[i + 1] << 8;
+    }
+    out += enc[v >> 18];
+    out += enc[(v >> 12) & 63];
+    out += i + 1 < size ? enc[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+// Decodes padded base64 into `out`; returns false on malformed input.
+inline bool base64Decode(const std::string &text, std::vector<uint8_t> &out) {
+  const int8_t *dec = detail::base64Tables().decode;
+  out.clear();
+  if (text.size() % 4 != 0) {
+    return false;
+  }
+  out.reserve(text.size() / 4 * 3);
+  for (size_t i = 0; i < text.size(); i += 4) {
+    int v[4];
+    int pad = 0;
+    for (int k = 0; k < 4; ++k) {
+      char c = text[i + k];
+      if (c == '=' && i + 4 == text.size() && k >= 2) {
+        v[k] = 0;
+        ++pad;
+        continue;
+      }
+      if (pad > 0) {
+        return false;
+      }
+      v[k] = dec[static_cast<uint8_t>(c)];
+      if (v[k] < 0) {
+        return false;
+      }
+    }
+    uint32_t bits = (v[0] << 18) | (v[1] << 12) | (v[2] << 6) | v[3];
+    out.push_back(static_cast<uint8_t>(bits >> 16));
+    if (pad < 2) {
+      out.push_back(static_cast<uint8_t>(bits >> 8));
+    }
+    if (pad < 1) {
+      out.push_back(static_cast<uint8_t>(bits));
+    }
+  }
+  return true;
+}
+
+} // namespace ipc
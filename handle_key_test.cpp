@@ -0,0 +1,230 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Handle key test
+//
+// Checks the 64-byte handle hash and equality and the hex and base64 codecs
+// of handle_key.h, then times lookups in a mapping table holding 100k
+// handles. The table is sized with mappingTableBuckets(), the rule the
+// consumer sizes its own table with. Like CUDA IPC handles of neighbouring
+// allocations, the keys differ in only a few bytes, so a weak hash shows up
+// as long bucket chains.
+// =============================================================================
+
+#include "handle_key.h"
+#include "mapping_table.h"
+#include "monotonic_clock.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+constexpr size_t kTableEntries = 100000;
+constexpr int kLookupRounds = 20;
+// A lookup with its reference take and drop costs ~150 ns in an optimised
+// build and a few hundred without optimisation. Degenerate bucket chains
+// cost tens of microseconds, so the bound leaves room for a loaded runner.
+constexpr double kMaxLookupNs = 2000;
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+// A handle-like key: a fixed header and a counter in bytes 16..19
+void makeKey(uint32_t n, uint8_t *key) {
+  for (size_t i = 0; i < ipc::kHandleSize; ++i) {
+    key[i] = static_cast<uint8_t>(0xC0 + i);
+  }
+  memcpy(key + 16, &n, sizeof(n));
+}
+
+void testEquality() {
+  // Offset by one byte, so the SIMD loads are unaligned
+  alignas(64) uint8_t a[ipc::kHandleSize + 1];
+  alignas(64) uint8_t b[ipc::kHandleSize + 1];
+  makeKey(7, a + 1);
+  makeKey(7, b + 1);
+  expect(ipc::handleBytesEqual(a + 1, b + 1), "equal handles compare equal");
+  expect(ipc::hashHandleBytes(a + 1) == ipc::hashHandleBytes(b + 1),
+         "equal handles hash alike");
+  bool all_detected = true;
+  bool all_rehashed = true;
+  for (size_t i = 0; i < ipc::kHandleSize; ++i) {
+    b[1 + i] ^= 0x01;
+    all_detected &= !ipc::handleBytesEqual(a + 1, b + 1);
+    all_rehashed &= ipc::hashHandleBytes(a + 1) != ipc::hashHandleBytes(b + 1);
+    b[1 + i] ^= 0x01;
+  }
+  expect(all_detected, "a flipped bit in any byte is detected");
+  expect(all_rehashed, "a flipped bit in any byte changes the hash");
+
+  std::unordered_set<uint64_t> hashes;
+  uint8_t key[ipc::kHandleSize];
+  for (uint32_t n = 0; n < kTableEntries; ++n) {
+    makeKey(n, key);
+    hashes.insert(ipc::hashHandleBytes(key));
+  }
+  expect(hashes.size() == kTableEntries, "no hash collisions among 100k keys");
+
+  std::unordered_set<ipc::HandleKey, ipc::HandleKeyHash, ipc::HandleKeyEqual>
+      set;
+  for (uint32_t n = 0; n < 2000; ++n) {
+    makeKey(n % 1000, key);
+    set.insert(ipc::HandleKey(key));
+  }
+  expect(set.size() == 1000, "HandleKey dedups handles in a standard set");
+}
+
+void testHex() {
+  uint8_t handle[ipc::kHandleSize];
+  for (size_t i = 0; i < sizeof(handle); ++i) {
+    handle[i] = static_cast<uint8_t>(i * 37);
+  }
+  const std::string text = ipc::hexEncode(handle, sizeof(handle));
+  expect(text.size() == 2 * sizeof(handle), "hex is two digits per byte");
+  expect(text.compare(0, 6, "00254A") == 0, "hex is upper case, high first");
+
+  uint8_t decoded[ipc::kHandleSize] = {};
+  expect(ipc::hexDecode(text, decoded, sizeof(decoded)) &&
+             memcmp(decoded, handle, sizeof(handle)) == 0,
+         "hex round trip");
+  std::string lower = "0x" + text;
+  for (char &c : lower) {
+    c = static_cast<char>(tolower(c));
+  }
+  memset(decoded, 0, sizeof(decoded));
+  expect(ipc::hexDecode(lower, decoded, sizeof(decoded)) &&
+             memcmp(decoded, handle, sizeof(handle)) == 0,
+         "hex decode takes lower case and a 0x prefix");
+
+  expect(!ipc::hexDecode(text.substr(1), decoded, sizeof(decoded)),
+         "hex decode rejects an odd length");
+  expect(!ipc::hexDecode(text + "00", decoded, sizeof(decoded)),
+         "hex decode rejects extra digits");
+  expect(!ipc::hexDecode("", decoded, sizeof(decoded)),
+         "hex decode rejects empty text");
+  std::string bad = text;
+  bad[10] = 'g';
+  expect(!ipc::hexDecode(bad, decoded, sizeof(decoded)),
+         "hex decode rejects a non-hex digit");
+}
+
+void testBase64() {
+  // RFC 4648 test vectors
+  const char *vectors[][2] = {{"", ""},         {"f", "Zg=="},
+                              {"fo", "Zm8="},   {"foo", "Zm9v"},
+                              {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="},
+                              {"foobar", "Zm9vYmFy"}};
+  std::vector<uint8_t> decoded;
+  for (const auto &v : vectors) {
+    const std::string encoded = ipc::base64Encode(v[0], strlen(v[0]));
+    expect(encoded == v[1], "base64 matches the RFC 4648 vectors");
+    expect(ipc::base64Decode(encoded, decoded) &&
+               std::string(decoded.begin(), decoded.end()) == v[0],
+           "base64 decodes the RFC 4648 vectors");
+  }
+
+  uint8_t handle[ipc::kHandleSize];
+  for (size_t i = 0; i < sizeof(handle); ++i) {
+    handle[i] = static_cast<uint8_t>(255 - i * 11);
+  }
+  for (size_t size = sizeof(handle) - 2; size <= sizeof(handle); ++size) {
+    expect(ipc::base64Decode(ipc::base64Encode(handle, size), decoded) &&
+               decoded.size() == size &&
+               memcmp(decoded.data(), handle, size) == 0,
+           "base64 round trip");
+  }
+
+  const char *malformed[] = {"Zm9",      "Zm9v!A==", "Z===",     "Zg=a",
+                             "Zg==Zm9v", "=m9v",     "Zm 9"};
+  for (const char *text : malformed) {
+    expect(!ipc::base64Decode(text, decoded), "base64 rejects malformed input");
+  }
+}
+
+// Average nanoseconds per lookup of every key in a table of kTableEntries
+double benchmarkTable() {
+  ipc::EpochManager epochs;
+  ipc::MappingTable table(epochs, [](ipc::MappingEntry &) {}, 0,
+                          ipc::mappingTableBuckets(kTableEntries));
+  std::vector<uint8_t> keys(kTableEntries * ipc::kHandleSize);
+  std::vector<ipc::MappingEntry *> entries(kTableEntries);
+  for (size_t n = 0; n < kTableEntries; ++n) {
+    uint8_t *key = &keys[n * ipc::kHandleSize];
+    makeKey(static_cast<uint32_t>(n), key);
+    bool hit = false;
+    entries[n] = table.acquireOrOpen(
+        key, [&](ipc::MappingEntry &e) { e.ptr = key; }, hit);
+    if (hit) {
+      throw std::runtime_error("fresh key reported as a cache hit");
+    }
+  }
+  expect(table.size() == kTableEntries, "table holds every key");
+
+  bool all_found = true;
+  const uint64_t start_ns = ipc::monotonicNs();
+  for (int round = 0; round < kLookupRounds; ++round) {
+    for (size_t n = 0; n < kTableEntries; ++n) {
+      ipc::MappingEntry *e = table.acquire(&keys[n * ipc::kHandleSize]);
+      all_found &= e == entries[n];
+      table.release(e);
+    }
+  }
+  const uint64_t elapsed_ns = ipc::monotonicNs() - start_ns;
+  expect(all_found, "every key finds its own entry");
+
+  uint8_t missing[ipc::kHandleSize];
+  makeKey(static_cast<uint32_t>(kTableEntries), missing);
+  expect(table.acquire(missing) == nullptr, "an absent key is not found");
+  return static_cast<double>(elapsed_ns) / (kLookupRounds * kTableEntries);
+}
+
+} // namespace
+
+int main() {
+  try {
+    testEquality();
+    testHex();
+    testBase64();
+    const double lookup_ns = benchmarkTable();
+    printf("%zu-entry mapping table: %.1f ns per lookup\n", kTableEntries,
+           lookup_ns);
+    expect(lookup_ns < kMaxLookupNs, "lookups stay in the nanosecond range");
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "handle_key_test: %s\n", e.what());
+    return 2;
+  }
+}
@@ -0,0 +1,313 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Host memory backend
+//
+// Emulates the subset of the CUDA runtime IPC API used by the sample on top of
+// POSIX shared memory, so the same producer/consumer flow can run on machines
+// without a GPU:
+// - malloc / free            ~ cudaMalloc / cudaFree
+// - getMemHandle             ~ cudaIpcGetMemHandle
+// - openMemHandle            ~ cudaIpcOpenMemHandle
+// - closeMemHandle           ~ cudaIpcCloseMemHandle
+//
+// Handles are 64 bytes, like cudaIpcMemHandle_t, and travel in the same
+// TensorDescriptor field.
+//
+// HostStagingPool recycles segments by power-of-two size class for the pooled
+// staging copy path.
+//
+// With a GpuCostProfile attached, every call also stalls for the cost the
+// matching CUDA call has on the profiled hardware. Staging segments are
+// plain host shared memory on real hardware too, so a staging pool gets a
+// backend of its own without a profile.
+// =============================================================================
+
+#pragma once
+
+#include "gpu_cost_profile.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ipc {
+
+struct HostIpcHandle {
+  char name[40]; // shm_open name, NUL terminated
+  uint64_t size;
+  uint64_t offset; // Offset of the exported pointer inside the segment
+  uint64_t reserved;
+};
+static_assert(sizeof(HostIpcHandle) == 64,
+              "HostIpcHandle must match cudaIpcMemHandle_t in size");
+
+class HostBackend {
+public:
+  // Segments of at least this size are advised to use transparent huge pages
+  // when the peers agreed on huge page support.
+  static constexpr size_t kHugePageThreshold = 2u << 20;
+
+  explicit HostBackend(bool huge_pages = false) : huge_pages_(huge_pages) {}
+
+  HostBackend(const HostBackend &) = delete;
+  HostBackend &operator=(const HostBackend &) = delete;
+
+  ~HostBackend() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &kv : owned_) {
+      munmap(kv.first, kv.second.size);
+      shm_unlink(kv.second.name.c_str());
+    }
+    for (auto &kv : opened_) {
+      munmap(kv.first, kv.second);
+    }
+  }
+
+  void setHugePages(bool enabled) { huge_pages_ = enabled; }
+
+  // The profile must outlive the backend.
+  void setCostProfile(const GpuCostProfile *profile) { costs_ = profile; }
+
+  void *malloc(size_t size) {
+    simulate(GpuCostProfile::kMalloc);
+    char name[sizeof(HostIpcHandle::name)];
+    snprintf(name, sizeof(name), "/cipc-%d-%llu", static_cast<int>(getpid()),
+             static_cast<unsigned long long>(nextSegmentId()));
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::runtime_error(std::string("shm_open failed: ") +
+                               strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      int err = errno;
+      close(fd);
+      shm_unlink(name);
+      throw std::runtime_error(std::string("ftruncate failed: ") +
+                               strerror(err));
+    }
+    void *ptr = map(fd, size);
+    close(fd);
+    if (ptr == nullptr) {
+      int err = errno;
+      shm_unlink(name);
+      throw std::runtime_error(std::string("mmap failed: ") + strerror(err));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    owned_[ptr] = Segment{name, size};
+    return ptr;
+  }
+
+  void free(void *ptr) {
+    simulate(GpuCostProfile::kFree);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = owned_.find(ptr);
+    if (it == owned_.end()) {
+      return;
+    }
+    munmap(ptr, it->second.size);
+    shm_unlink(it->second.name.c_str());
+    owned_.erase(it);
+  }
+
+  HostIpcHandle getMemHandle(void *ptr) {
+    simulate(GpuCostProfile::kGetHandle);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &kv : owned_) {
+      char *base = static_cast<char *>(kv.first);
+      char *p = static_cast<char *>(ptr);
+      if (p >= base && p < base + kv.second.size) {
+        HostIpcHandle handle{};
+        snprintf(handle.name, sizeof(handle.name), "%s",
+                 kv.second.name.c_str());
+        handle.size = kv.second.size;
+        handle.offset = static_cast<uint64_t>(p - base);
+        return handle;
+      }
+    }
+    throw std::runtime_error("getMemHandle: pointer not owned by host backend");
+  }
+
+  // Returns the pointer the handle was exported for, like
+  // cudaIpcOpenMemHandle.
+  void *openMemHandle(const HostIpcHandle &handle) {
+    simulate(GpuCostProfile::kOpenHandle);
+    int fd = shm_open(handle.name, O_RDWR, 0);
+    if (fd < 0) {
+      throw std::runtime_error(std::string("shm_open of ") + handle.name +
+                               " failed: " + strerror(errno));
+    }
+    void *ptr = map(fd, handle.size);
+    int err = errno;
+    close(fd);
+    if (ptr == nullptr) {
+      throw std::runtime_error(std::string("mmap failed: ") + strerror(err));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    opened_[ptr] = handle.size;
+    return static_cast<char *>(ptr) + handle.offset;
+  }
+
+  // Returns false, without charging the close, for a pointer this backend
+  // did not open.
+  bool closeMemHandle(void *ptr) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = opened_.begin();
+      for (; it != opened_.end(); ++it) {
+        char *base = static_cast<char *>(it->first);
+        char *p = static_cast<char *>(ptr);
+        if (p >= base && p < base + it->second) {
+          break;
+        }
+      }
+      if (it == opened_.end()) {
+        return false;
+      }
+      munmap(it->first, it->second);
+      opened_.erase(it);
+    }
+    simulate(GpuCostProfile::kCloseHandle);
+    return true;
+  }
+
+private:
+  struct Segment {
+    std::string name;
+    size_t size;
+  };
+
+  // Shared by every backend in the process, so their names never collide
+  static uint64_t nextSegmentId() {
+    static std::atomic<uint64_t> next{0};
+    return next++;
+  }
+
+  void simulate(GpuCostProfile::Op op) const {
+    if (costs_ != nullptr) {
+      costs_->inject(op);
+    }
+  }
+
+  void *map(int fd, size_t size) {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_ && size >= kHugePageThreshold) {
+      madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+  }
+
+  bool huge_pages_;
+  const GpuCostProfile *costs_ = nullptr;
+  std::mutex mutex_;
+  std::unordered_map<void *, Segment> owned_;
+  std::unordered_map<void *, size_t> opened_;
+};
+
+// Reusable staging segments. A slot handed out by acquire() stays busy until
+// the consumer reports that it copied the payload out.
+class HostStagingPool {
+public:
+  explicit HostStagingPool(HostBackend &backend) : backend_(backend) {}
+
+  HostStagingPool(const HostStagingPool &) = delete;
+  HostStagingPool &operator=(const HostStagingPool &) = delete;
+
+  ~HostStagingPool() {
+    for (auto &kv : slots_) {
+      backend_.free(kv.first);
+    }
+  }
+
+  // Only the first use of a slot allocates; recycled slots keep their
+  // bookkeeping, so the steady state does not touch the heap.
+  void *acquire(size_t nbytes) {
+    int cls = sizeClass(nbytes);
+    void *ptr;
+    if (!free_[cls].empty()) {
+      ptr = free_[cls].back();
+      free_[cls].pop_back();
+    } else {
+      ptr = backend_.malloc(size_t(1) << cls);
+      slots_[ptr] = {cls, false};
+      // Room for every slot of the class, so release never grows the list
+      free_[cls].reserve(++class_slots_[cls]);
+    }
+    slots_[ptr].busy = true;
+    ++busy_;
+    return ptr;
+  }
+
+  void release(void *ptr) {
+    auto it = slots_.find(ptr);
+    if (it == slots_.end() || !it->second.busy) {
+      return;
+    }
+    it->second.busy = false;
+    --busy_;
+    free_[it->second.cls].push_back(ptr);
+  }
+
+  size_t busySlots() const { return busy_; }
+
+private:
+  static constexpr int kMinClass = 12; // One page
+  static constexpr int kNumClasses = 48;
+
+  static int sizeClass(size_t nbytes) {
+    int cls = kMinClass;
+    while ((size_t(1) << cls) < nbytes && cls < kNumClasses - 1) {
+      ++cls;
+    }
+    return cls;
+  }
+
+  struct Slot {
+    int cls;
+    bool busy;
+  };
+
+  HostBackend &backend_;
+  std::vector<void *> free_[kNumClasses];
+  std::unordered_map<void *, Slot> slots_; // Every slot, busy or free
+  size_t class_slots_[kNumClasses] = {};
+  size_t busy_ = 0;
+};
+
+} // namespace ipc
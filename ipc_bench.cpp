@@ -0,0 +1,712 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Host-only IPC benchmark and regression gate
+//
+// Runs a fixed scenario matrix (backend x delivery path x tensor size x batch
+// size) between this process and a forked consumer, using the host backend
+// so it needs neither a GPU nor LibTorch. The `gpu_sim` backend is the host
+// backend with a GPU cost profile (--profile or IPC_GPU_PROFILE) attached
+// and is skipped without one. The consumer uses the sample's mapping table,
+// deferred reclaimer, tenant scheduler and dynamic batcher, so the gate
+// covers them as well as the backend and copy costs.
+//
+// Every scenario is repeated. The reported median batch round trip is the
+// median of the per-repetition medians; the p99 is taken over the samples of
+// all repetitions together, so a single scheduler hiccup cannot move it.
+// Right before each run of a scenario, including every --confirm re-run, a
+// calibration measures what the same batch costs without the sample's code:
+// a one-byte pipe round trip to a forked child plus a memcpy of the batch's
+// bytes. With --baseline the scenario's cost relative to that calibration is
+// compared against a baseline recorded on the same machine, so a busier
+// moment shifts both sides alike, and the process exits non-zero when a
+// scenario regressed beyond the tolerances. The ratios do not carry across
+// machines; record the baseline on the runner with --write-baseline. A
+// scenario that looks regressed is measured --confirm more times and judged
+// on the median of all its runs, each metric on its own. One noisy run on a
+// shared runner can then neither fail the gate nor hide a real regression.
+//
+// --write-baseline records the median of --capture-runs runs of every
+// scenario as the new baseline, and fails rather than record a p99 more than
+// --max-tail times its median, which would disarm the p99 check.
+// =============================================================================
+
+#include "deferred_reclaimer.h"
+#include "dynamic_batcher.h"
+#include "gpu_cost_profile.h"
+#include "host_backend.h"
+#include "ipc_protocol.h"
+#include "lane_io.h"
+#include "mapping_table.h"
+#include "slab_allocator.h"
+#include "tenant_scheduler.h"
+#include "transport_cost_model.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Scenario {
+  std::string backend;
+  ipc::DeliveryPath path;
+  uint64_t nbytes;
+  int batch;
+
+  std::string name() const {
+    return backend + "/" + ipc::deliveryPathName(path) + "/" +
+           std::to_string(nbytes) + "/" + std::to_string(batch);
+  }
+};
+
+struct Result {
+  double median_ns = 0;
+  double p99_ns = 0;
+  double calib_ns = 0; // Calibration measured with this result
+
+  double medianRatio() const { return median_ns / calib_ns; }
+  double p99Ratio() const { return p99_ns / calib_ns; }
+  double tail() const { return p99_ns / median_ns; }
+};
+
+struct Options {
+  std::string baseline;
+  std::string json;
+  std::string write_baseline;
+  std::string profile;
+  std::string filter;
+  int reps = 3;
+  int confirm = 2;
+  int capture_runs = 3;
+  double median_tolerance = 0.25;
+  double p99_tolerance = 0.5;
+  double max_tail = 10;
+};
+
+std::vector<Scenario> scenarioMatrix() {
+  std::vector<Scenario> matrix;
+  for (const char *backend : {"host", "gpu_sim"}) {
+    for (ipc::DeliveryPath path :
+         {ipc::DeliveryPath::kIpcMapping, ipc::DeliveryPath::kPooledStaging,
+          ipc::DeliveryPath::kInlineCopy}) {
+      for (uint64_t nbytes : {uint64_t(4) << 10, uint64_t(256) << 10,
+                              uint64_t(4) << 20}) {
+        for (int batch : {1, 8}) {
+          matrix.push_back({backend, path, nbytes, batch});
+        }
+      }
+    }
+  }
+  return matrix;
+}
+
+double percentile(std::vector<uint64_t> samples, double q) {
+  std::sort(samples.begin(), samples.end());
+  size_t k = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+  return static_cast<double>(samples[k]);
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// Idle mappings the consumer keeps open, as with the sample's default
+// IPC_MAPPING_CACHE.
+constexpr size_t kMappingCache = 16;
+
+// Consumer side of one repetition, built from the same parts as the
+// sample's consumer: descriptors are queued per tenant, mapped through the
+// mapping table or copied, and collected into batches of `s.batch`. Every
+// tensor is acknowledged with a cost feedback message; mappings are handed
+// back through the deferred reclaimer once their batch is emitted, and the
+// producer learns about unmapped slabs from its release batches.
+void runConsumer(int desc_read, int ack_write,
+                 const ipc::GpuCostProfile &costs, const Scenario &s) {
+  ipc::HostBackend host;
+  host.setCostProfile(costs.enabled() ? &costs : nullptr);
+  ipc::HostBackend staging_host; // Staging slots pay no simulated CUDA cost
+
+  ipc::EpochManager epochs;
+  // Only touched on the reclaimer thread
+  std::vector<ipc::ReleaseRecord> unmapped;
+  ipc::MappingTable mappings(
+      epochs,
+      [&host, &staging_host, &unmapped](ipc::MappingEntry &entry) {
+        if (!staging_host.closeMemHandle(entry.ptr)) {
+          host.closeMemHandle(entry.ptr);
+        }
+        if (entry.release_id >= 0) {
+          unmapped.push_back(
+              {entry.release_id, entry.uses.load(std::memory_order_relaxed)});
+        }
+      },
+      kMappingCache);
+  ipc::DeferredReclaimer reclaimer(
+      [&mappings](const ipc::CloseRequest &request) {
+        if (request.ptr == nullptr) {
+          mappings.trimIdle(0);
+        } else {
+          mappings.retainIdle(static_cast<ipc::MappingEntry *>(request.ptr),
+                              request.tag);
+        }
+      },
+      [ack_write](const ipc::ReleaseRecord *records, size_t count) {
+        ipc::writeReleaseBatch(ack_write, records, count);
+      },
+      {},
+      [&epochs, &unmapped](std::vector<ipc::ReleaseRecord> &released) {
+        epochs.reclaim();
+        released.insert(released.end(), unmapped.begin(), unmapped.end());
+        unmapped.clear();
+        return epochs.pending() > 0;
+      });
+  auto releaseMapping = [&mappings, &reclaimer](ipc::MappingEntry *entry) {
+    const uint8_t kind = entry->kind;
+    const uint64_t hash = entry->hash;
+    if (mappings.release(entry)) {
+      reclaimer.enqueue({entry, -1, kind, hash});
+    }
+  };
+
+  struct Received {
+    ipc::MappingEntry *entry; // Null once the bytes were copied out
+    uint32_t tenant;
+    uint64_t nbytes;
+  };
+  ipc::TenantScheduler<ipc::PendingDescriptor> scheduler(
+      ipc::SchedulePolicy::kDrr, uint64_t(64) << 10, ipc::TenantQuota());
+  // The producer waits for every batch, so only a full one is emitted
+  ipc::DynamicBatcher<Received> batcher(s.batch, UINT64_MAX / 2);
+  std::vector<Received> batch;
+  ipc::LaneReader reader({desc_read});
+  std::vector<char> buffer(s.nbytes);
+  volatile char sink = 0;
+  for (bool done = false; !done;) {
+    for (int b = 0; b < s.batch; ++b) {
+      ipc::PendingDescriptor pending;
+      reader.read(0, pending);
+      if (pending.desc.index == ipc::kEndOfStreamIndex) {
+        done = true;
+        break;
+      }
+      const uint32_t tenant = pending.desc.tenant;
+      const uint64_t nbytes = pending.desc.nbytes;
+      scheduler.push(tenant, 0, nbytes, 0, std::move(pending));
+    }
+
+    ipc::PendingDescriptor pending;
+    uint32_t tenant = 0;
+    while (scheduler.pop(pending, tenant)) {
+      const ipc::TensorDescriptor &desc = pending.desc;
+      const uint64_t start_ns = ipc::monotonicNs();
+      bool cache_hit = false;
+      ipc::MappingEntry *entry = nullptr;
+      if (desc.transport == static_cast<uint8_t>(ipc::Transport::kStagedCopy)) {
+        memcpy(buffer.data(), pending.payload.data(), desc.nbytes);
+        costs.inject(ipc::GpuCostProfile::kCopyH2D, desc.nbytes);
+        sink = buffer[0];
+        reader.recycle(pending.payload);
+      } else {
+        const bool staged = desc.path == static_cast<uint8_t>(
+                                             ipc::DeliveryPath::kPooledStaging);
+        entry = mappings.acquireOrOpen(
+            desc.handle,
+            [&](ipc::MappingEntry &e) {
+              ipc::HostIpcHandle handle;
+              memcpy(&handle, desc.handle, sizeof(handle));
+              e.ptr = (staged ? staging_host : host).openMemHandle(handle);
+              e.size = handle.size;
+              e.kind = static_cast<uint8_t>(ipc::Transport::kHostShm);
+              e.release_id = staged ? -1 : desc.alloc_id;
+            },
+            cache_hit);
+        const char *data = static_cast<const char *>(entry->ptr) + desc.offset;
+        if (staged) {
+          // The producer recycles the slot, so copy out of it right away
+          memcpy(buffer.data(), data, desc.nbytes);
+          costs.inject(ipc::GpuCostProfile::kCopyH2D, desc.nbytes);
+          sink = buffer[0];
+          releaseMapping(entry);
+          entry = nullptr;
+        } else {
+          sink = data[0] ^ data[desc.nbytes - 1];
+        }
+      }
+
+      ipc::BackMessage feedback{};
+      feedback.type = static_cast<uint8_t>(ipc::BackMessageType::kCostFeedback);
+      feedback.path = desc.path;
+      feedback.cache_hit = cache_hit ? 1 : 0;
+      feedback.index = desc.index;
+      feedback.nbytes = desc.nbytes;
+      feedback.consumer_ns = ipc::monotonicNs() - start_ns;
+      ipc::writeExact(ack_write, &feedback, sizeof(feedback), "cost feedback");
+      if (batcher.add({entry, tenant, desc.nbytes}, start_ns,
+                      ipc::monotonicNs())) {
+        batcher.take(batch);
+        for (const Received &r : batch) {
+          if (r.entry != nullptr) {
+            releaseMapping(r.entry);
+          }
+          scheduler.release(r.tenant, r.nbytes);
+        }
+      }
+    }
+  }
+  (void)sink;
+
+  // Unmap everything and report it before saying goodbye
+  reclaimer.enqueue({nullptr, -1, 0, 0});
+  reclaimer.flush();
+  ipc::BackMessage done{};
+  done.type = static_cast<uint8_t>(ipc::BackMessageType::kConsumerDone);
+  ipc::writeExact(ack_write, &done, sizeof(done), "done signal");
+}
+
+// Reads consumer messages until `count` of `type` have arrived, returning
+// the slabs of every release batch on the way to `slabs`.
+void awaitMessages(int fd, ipc::BackMessageType type, int count,
+                   ipc::SlabAllocator &slabs) {
+  while (count > 0) {
+    ipc::BackMessage msg;
+    ipc::readExact(fd, &msg, sizeof(msg), "consumer message");
+    if (msg.type == static_cast<uint8_t>(ipc::BackMessageType::kRelease)) {
+      ipc::ReleaseRecord records[ipc::kMaxReleaseBatch];
+      const size_t n = static_cast<size_t>(msg.index);
+      if (n > ipc::kMaxReleaseBatch) {
+        throw std::runtime_error("Malformed release batch");
+      }
+      ipc::readExact(fd, records, n * sizeof(ipc::ReleaseRecord),
+                     "release batch");
+      for (size_t k = 0; k < n; ++k) {
+        slabs.releaseRemote(records[k].id, records[k].count);
+      }
+    } else if (msg.type == static_cast<uint8_t>(type)) {
+      --count;
+    }
+  }
+}
+
+// Producer side: returns one batch round trip time per iteration.
+std::vector<uint64_t> runProducer(int desc_write, int ack_read,
+                                  const ipc::GpuCostProfile &costs,
+                                  const Scenario &s, int iterations) {
+  ipc::HostBackend host;
+  host.setCostProfile(costs.enabled() ? &costs : nullptr);
+  ipc::HostBackend staging_host; // Staging slots pay no simulated CUDA cost
+  ipc::HostStagingPool staging(staging_host);
+  ipc::SlabAllocator slabs([&host](size_t n) { return host.malloc(n); },
+                           [&host](void *p) { host.free(p); }, 2u << 20);
+  ipc::LaneWriter writer({desc_write});
+  std::vector<void *> slots;
+  std::vector<uint64_t> samples;
+  const int warmup = std::max(2, iterations / 10);
+  int index = 0;
+  for (int it = 0; it < warmup + iterations; ++it) {
+    uint64_t start_ns = ipc::monotonicNs();
+    for (int b = 0; b < s.batch; ++b) {
+      ipc::SlabAllocation alloc = slabs.allocate(s.nbytes);
+      memset(alloc.ptr, it & 0xff, s.nbytes);
+      ipc::TensorDescriptor desc{};
+      desc.index = ++index;
+      desc.path = static_cast<uint8_t>(s.path);
+      desc.nbytes = s.nbytes;
+      desc.tenant = b % 2; // Two tenants share each batch
+      desc.alloc_id = -1;
+      switch (s.path) {
+      case ipc::DeliveryPath::kIpcMapping: {
+        if (slabs.cachedHandle(alloc.alloc_id) == nullptr) {
+          ipc::HostIpcHandle handle = host.getMemHandle(alloc.base);
+          slabs.setHandle(alloc.alloc_id, &handle);
+        }
+        desc.transport = static_cast<uint8_t>(ipc::Transport::kHostShm);
+        desc.alloc_id = alloc.alloc_id;
+        desc.offset = alloc.offset;
+        memcpy(desc.handle, slabs.cachedHandle(alloc.alloc_id),
+               sizeof(desc.handle));
+        writer.send(desc);
+        slabs.markExported(alloc.alloc_id, s.nbytes);
+        break;
+      }
+      case ipc::DeliveryPath::kPooledStaging: {
+        void *slot = staging.acquire(s.nbytes);
+        slots.push_back(slot);
+        memcpy(slot, alloc.ptr, s.nbytes);
+        costs.inject(ipc::GpuCostProfile::kCopyD2H, s.nbytes);
+        ipc::HostIpcHandle handle = staging_host.getMemHandle(slot);
+        desc.transport = static_cast<uint8_t>(ipc::Transport::kHostShm);
+        memcpy(desc.handle, &handle, sizeof(handle));
+        writer.send(desc);
+        slabs.releaseLocal(alloc.alloc_id);
+        break;
+      }
+      case ipc::DeliveryPath::kInlineCopy:
+        memcpy(writer.payload(s.nbytes), alloc.ptr, s.nbytes);
+        costs.inject(ipc::GpuCostProfile::kCopyD2H, s.nbytes);
+        desc.transport = static_cast<uint8_t>(ipc::Transport::kStagedCopy);
+        writer.send(desc, s.nbytes);
+        slabs.releaseLocal(alloc.alloc_id);
+        break;
+      }
+    }
+    awaitMessages(ack_read, ipc::BackMessageType::kCostFeedback, s.batch,
+                  slabs);
+    for (void *slot : slots) {
+      staging.release(slot);
+    }
+    slots.clear();
+    if (it >= warmup) {
+      samples.push_back(ipc::monotonicNs() - start_ns);
+    }
+  }
+  ipc::TensorDescriptor end{};
+  end.index = ipc::kEndOfStreamIndex;
+  writer.send(end);
+  awaitMessages(ack_read, ipc::BackMessageType::kConsumerDone, 1, slabs);
+  return samples;
+}
+
+// Median cost of a one-byte pipe round trip to a forked child plus a memcpy
+// of `nbytes`: the floor a batch of that size cannot go below on this
+// machine right now.
+double runCalibration(uint64_t nbytes) {
+  constexpr int kIterations = 200;
+  int ping[2], pong[2];
+  if (pipe(ping) != 0 || pipe(pong) != 0) {
+    throw std::runtime_error(std::string("pipe failed: ") + strerror(errno));
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+  }
+  if (pid == 0) {
+    close(ping[1]);
+    close(pong[0]);
+    char byte;
+    while (read(ping[0], &byte, 1) == 1) {
+      if (write(pong[1], &byte, 1) != 1) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  close(ping[0]);
+  close(pong[1]);
+  std::vector<char> src(nbytes, 1), dst(nbytes);
+  std::vector<uint64_t> round_trips, copies;
+  for (int k = 0; k < kIterations; ++k) {
+    uint64_t start_ns = ipc::monotonicNs();
+    char byte = 0;
+    ipc::writeExact(ping[1], &byte, 1, "calibration ping");
+    ipc::readExact(pong[0], &byte, 1, "calibration pong");
+    round_trips.push_back(ipc::monotonicNs() - start_ns);
+    start_ns = ipc::monotonicNs();
+    memcpy(dst.data(), src.data(), nbytes);
+    copies.push_back(ipc::monotonicNs() - start_ns);
+    src[k % nbytes] = dst[(k + 1) % nbytes];
+  }
+  close(ping[1]);
+  close(pong[0]);
+  waitpid(pid, nullptr, 0);
+  return percentile(round_trips, 0.5) + percentile(copies, 0.5);
+}
+
+Result runScenario(const Scenario &s, const ipc::GpuCostProfile &costs,
+                   int reps) {
+  // Enough iterations for a stable p99 without spending long on big tensors:
+  // small batches get thousands of samples per repetition
+  const uint64_t batch_bytes = s.nbytes * s.batch;
+  const int iterations = static_cast<int>(std::min<uint64_t>(
+      5000, std::max<uint64_t>(100, (256u << 20) / batch_bytes)));
+  // Calibrate first, so it sees the machine as the repetitions will
+  const double calib_ns = runCalibration(batch_bytes);
+  std::vector<double> medians;
+  std::vector<uint64_t> all_samples;
+  for (int r = 0; r < reps; ++r) {
+    int desc_pipe[2], ack_pipe[2];
+    if (pipe(desc_pipe) != 0 || pipe(ack_pipe) != 0) {
+      throw std::runtime_error(std::string("pipe failed: ") +
+                               strerror(errno));
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+    }
+    if (pid == 0) {
+      close(desc_pipe[1]);
+      close(ack_pipe[0]);
+      int status = 0;
+      try {
+        runConsumer(desc_pipe[0], ack_pipe[1], costs, s);
+      } catch (const std::exception &e) {
+        fprintf(stderr, "consumer: %s\n", e.what());
+        status = 1;
+      }
+      _exit(status);
+    }
+    close(desc_pipe[0]);
+    close(ack_pipe[1]);
+    std::vector<uint64_t> samples =
+        runProducer(desc_pipe[1], ack_pipe[0], costs, s, iterations);
+    close(desc_pipe[1]);
+    close(ack_pipe[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      throw std::runtime_error("Consumer failed in " + s.name());
+    }
+    medians.push_back(percentile(samples, 0.5));
+    all_samples.insert(all_samples.end(), samples.begin(), samples.end());
+  }
+  return {median(medians), percentile(all_samples, 0.99), calib_ns};
+}
+
+// The median median and the median p99 of several runs of one scenario,
+// each judged against its own calibration, expressed against the median
+// calibration.
+Result medianOf(const std::vector<Result> &runs) {
+  std::vector<double> medians, p99s, calibs;
+  for (const Result &r : runs) {
+    medians.push_back(r.medianRatio());
+    p99s.push_back(r.p99Ratio());
+    calibs.push_back(r.calib_ns);
+  }
+  Result r;
+  r.calib_ns = median(calibs);
+  r.median_ns = median(medians) * r.calib_ns;
+  r.p99_ns = median(p99s) * r.calib_ns;
+  return r;
+}
+
+// A baseline entry: the median of --capture-runs runs, so neither a lucky
+// nor an unlucky run sets the bar. A capture whose p99 is more than
+// --max-tail times its median is taken again up to --confirm times and then
+// rejected, since an inflated baseline p99 would let almost any p99
+// regression pass.
+Result captureScenario(const Scenario &s, const ipc::GpuCostProfile &costs,
+                       const Options &o) {
+  for (int attempt = 0;; ++attempt) {
+    std::vector<Result> runs;
+    for (int k = 0; k < o.capture_runs; ++k) {
+      runs.push_back(runScenario(s, costs, o.reps));
+    }
+    const Result r = medianOf(runs);
+    if (r.tail() <= o.max_tail) {
+      return r;
+    }
+    if (attempt >= o.confirm) {
+      char msg[256];
+      snprintf(msg, sizeof(msg),
+               "%s has a p99 %.1f times its median, above --max-tail %.1f; "
+               "record the baseline on a quieter machine",
+               s.name().c_str(), r.tail(), o.max_tail);
+      throw std::runtime_error(msg);
+    }
+  }
+}
+
+std::string toJson(const std::map<std::string, Result> &results) {
+  std::ostringstream out;
+  out << "{\n  \"scenarios\": [\n";
+  size_t k = 0;
+  for (const auto &kv : results) {
+    out << "    {\"name\": \"" << kv.first << "\", \"median_ns\": "
+        << static_cast<uint64_t>(kv.second.median_ns)
+        << ", \"p99_ns\": " << static_cast<uint64_t>(kv.second.p99_ns)
+        << ", \"calib_ns\": " << static_cast<uint64_t>(kv.second.calib_ns)
+        << "}" << (++k < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+// Reads the files toJson() writes; one scenario object per line.
+std::map<std::string, Result> fromJson(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Cannot open baseline " + path + ": " +
+                             strerror(errno));
+  }
+  auto field = [](const std::string &line, const std::string &key) {
+    size_t pos = line.find("\"" + key + "\":");
+    if (pos == std::string::npos) {
+      return std::string();
+    }
+    pos = line.find_first_not_of(" \"", pos + key.size() + 3);
+    size_t end = line.find_first_of("\",}", pos);
+    return line.substr(pos, end - pos);
+  };
+  std::map<std::string, Result> results;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string name = field(line, "name");
+    if (name.empty()) {
+      continue;
+    }
+    results[name] = {strtod(field(line, "median_ns").c_str(), nullptr),
+                     strtod(field(line, "p99_ns").c_str(), nullptr),
+                     strtod(field(line, "calib_ns").c_str(), nullptr)};
+  }
+  return results;
+}
+
+void writeFile(const std::string &path, const std::string &text) {
+  std::ofstream out(path);
+  out << text;
+  if (!out) {
+    throw std::runtime_error("Cannot write " + path);
+  }
+}
+
+Options parseOptions(int argc, char *argv[]) {
+  Options o;
+  const char *env_profile = getenv("IPC_GPU_PROFILE");
+  o.profile = env_profile != nullptr ? env_profile : "";
+  for (int k = 1; k < argc; ++k) {
+    std::string arg = argv[k];
+    if (k + 1 >= argc) {
+      throw std::runtime_error("Missing value for " + arg);
+    }
+    std::string value = argv[++k];
+    if (arg == "--baseline") {
+      o.baseline = value;
+    } else if (arg == "--json") {
+      o.json = value;
+    } else if (arg == "--write-baseline") {
+      o.write_baseline = value;
+    } else if (arg == "--profile") {
+      o.profile = value;
+    } else if (arg == "--filter") {
+      o.filter = value;
+    } else if (arg == "--reps") {
+      o.reps = std::max(1, atoi(value.c_str()));
+    } else if (arg == "--confirm") {
+      o.confirm = std::max(0, atoi(value.c_str()));
+    } else if (arg == "--median-tolerance") {
+      o.median_tolerance = strtod(value.c_str(), nullptr);
+    } else if (arg == "--p99-tolerance") {
+      o.p99_tolerance = strtod(value.c_str(), nullptr);
+    } else if (arg == "--capture-runs") {
+      o.capture_runs = std::max(1, atoi(value.c_str()));
+    } else if (arg == "--max-tail") {
+      o.max_tail = strtod(value.c_str(), nullptr);
+    } else {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+  }
+  return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  try {
+    Options options = parseOptions(argc, argv);
+    ipc::GpuCostProfile costs;
+    if (!options.profile.empty()) {
+      costs.load(options.profile);
+    }
+
+    std::map<std::string, Result> baseline;
+    if (!options.baseline.empty()) {
+      baseline = fromJson(options.baseline);
+    }
+    // A scenario regresses when its median or p99, relative to the
+    // calibration of the same run, grew past the tolerance; scenarios
+    // missing from the baseline or without a calibration are not compared
+    auto comparable = [&](const std::string &name) {
+      auto it = baseline.find(name);
+      return it != baseline.end() && it->second.median_ns > 0 &&
+             it->second.p99_ns > 0 && it->second.calib_ns > 0;
+    };
+    auto regressed = [&](const std::string &name, const Result &r) {
+      if (!comparable(name)) {
+        return false;
+      }
+      const Result &base = baseline.at(name);
+      return r.medianRatio() >
+                 base.medianRatio() * (1 + options.median_tolerance) ||
+             r.p99Ratio() > base.p99Ratio() * (1 + options.p99_tolerance);
+    };
+
+    std::map<std::string, Result> results;
+    int regressions = 0;
+    for (const Scenario &s : scenarioMatrix()) {
+      if ((s.backend == "gpu_sim" && !costs.enabled()) ||
+          s.name().find(options.filter) == std::string::npos) {
+        continue;
+      }
+      const ipc::GpuCostProfile none;
+      const ipc::GpuCostProfile &scenario_costs =
+          s.backend == "gpu_sim" ? costs : none;
+      Result r = options.write_baseline.empty()
+                     ? runScenario(s, scenario_costs, options.reps)
+                     : captureScenario(s, scenario_costs, options);
+      if (options.confirm > 0 && regressed(s.name(), r)) {
+        std::vector<Result> runs{r};
+        for (int k = 0; k < options.confirm; ++k) {
+          runs.push_back(runScenario(s, scenario_costs, options.reps));
+        }
+        r = medianOf(runs);
+      }
+      results[s.name()] = r;
+      printf("%-36s median %10.0f ns  p99 %10.0f ns  calib %9.0f ns",
+             s.name().c_str(), r.median_ns, r.p99_ns, r.calib_ns);
+      if (comparable(s.name())) {
+        const Result &base = baseline.at(s.name());
+        const bool bad = regressed(s.name(), r);
+        regressions += bad ? 1 : 0;
+        printf("  median x%.2f  p99 x%.2f  %s",
+               r.medianRatio() / base.medianRatio(),
+               r.p99Ratio() / base.p99Ratio(), bad ? "REGRESSED" : "ok");
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+
+    if (!options.json.empty()) {
+      writeFile(options.json, toJson(results));
+    }
+    if (!options.write_baseline.empty()) {
+      writeFile(options.write_baseline, toJson(results));
+    }
+    if (!options.baseline.empty()) {
+      printf("%d regression(s)\n", regressions);
+    }
+    return regressions == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "ipc_bench: %s\n", e.what());
+    return 2;
+  }
+}
@@ -0,0 +1,458 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// =============================================================================
+// Wire protocol shared by the producer and consumer processes
+//
+// - Capability record exchanged once at connect time
+// - Transport negotiation (fastest mutually supported path)
+// - Per-tensor descriptor framing
+// - Consumer -> producer feedback messages
+// - Exact-length pipe I/O helpers
+//
+// Everything here is plain C++/POSIX so that it can be reused by tools that do
+// not link against CUDA or LibTorch.
+// =============================================================================
+
+#pragma once
+
+#include "monotonic_clock.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits.h>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace ipc {
+
+constexpr uint32_t kProtocolMagic = 0x43495043; // "CIPC"
+constexpr uint16_t kProtocolVersion = 9;
+constexpr uint16_t kMinProtocolVersion = 9;
+
+// Where tensor memory lives in a process.
+enum BackendKind : uint32_t {
+  kBackendCuda = 1u << 0, // Device memory from cudaMalloc
+  kBackendHost = 1u << 1, // Host memory from POSIX shared memory segments
+};
+
+// Ways of moving a tensor from the producer to the consumer, fastest first.
+enum class Transport : uint8_t {
+  kNone = 0,
+  kCudaIpc = 1,    // cudaIpcGetMemHandle / cudaIpcOpenMemHandle
+  kVmmFd = 2,      // cuMemExportToShareableHandle with a POSIX fd
+  kPoolExport = 3, // cudaMemPoolExportToShareableHandle
+  kHostShm = 4,    // Named POSIX shared memory segment
+  kStagedCopy = 5, // Payload bytes sent inline on the tensor pipe
+};
+
+constexpr Transport kTransportPreference[] = {
+    Transport::kCudaIpc, Transport::kVmmFd, Transport::kPoolExport,
+    Transport::kHostShm, Transport::kStagedCopy};
+
+constexpr uint32_t transportBit(Transport t) {
+  return 1u << static_cast<uint32_t>(t);
+}
+
+inline const char *transportName(Transport t) {
+  switch (t) {
+  case Transport::kCudaIpc:
+    return "cuda_ipc";
+  case Transport::kVmmFd:
+    return "vmm_fd";
+  case Transport::kPoolExport:
+    return "pool_export";
+  case Transport::kHostShm:
+    return "host_shm";
+  case Transport::kStagedCopy:
+    return "staged_copy";
+  default:
+    return "none";
+  }
+}
+
+inline Transport transportFromName(const std::string &name) {
+  for (Transport t : kTransportPreference) {
+    if (name == transportName(t)) {
+      return t;
+    }
+  }
+  return Transport::kNone;
+}
+
+// Element type of a tensor on the wire. Tensors are one-dimensional, with
+// nbytes / dtypeSize(dtype) elements.
+enum class DType : uint8_t {
+  kInt32 = 0,
+  kInt64 = 1,
+  kUInt8 = 2,
+  kFloat32 = 3,
+  kFloat16 = 4,
+  kBFloat16 = 5,
+};
+
+constexpr DType kDTypes[] = {DType::kInt32,   DType::kInt64,
+                             DType::kUInt8,   DType::kFloat32,
+                             DType::kFloat16, DType::kBFloat16};
+
+inline const char *dtypeName(DType d) {
+  switch (d) {
+  case DType::kInt32:
+    return "int32";
+  case DType::kInt64:
+    return "int64";
+  case DType::kUInt8:
+    return "uint8";
+  case DType::kFloat32:
+    return "float32";
+  case DType::kFloat16:
+    return "float16";
+  case DType::kBFloat16:
+    return "bfloat16";
+  }
+  return "unknown";
+}
+
+inline size_t dtypeSize(DType d) {
+  switch (d) {
+  case DType::kUInt8:
+    return 1;
+  case DType::kFloat16:
+  case DType::kBFloat16:
+    return 2;
+  case DType::kInt32:
+  case DType::kFloat32:
+    return 4;
+  case DType::kInt64:
+    return 8;
+  }
+  return 1;
+}
+
+inline bool dtypeFromName(const std::string &name, DType &dtype) {
+  for (DType d : kDTypes) {
+    if (name == dtypeName(d)) {
+      dtype = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Fixed-size record each side sends once before any tensor traffic.
+struct CapabilityRecord {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t min_version;
+  uint32_t backends;   // BackendKind bitmask
+  uint32_t transports; // transportBit() bitmask
+  uint64_t boot_id_hash;
+  uint64_t hostname_hash;
+  uint64_t ipc_ns_inode;
+  uint64_t pid_ns_inode;
+  uint8_t device_uuid[16]; // All zero for the host backend
+  int32_t device;
+  uint8_t huge_pages; // Shared memory can be backed by transparent huge pages
+  uint8_t reserved[3];
+};
+static_assert(std::is_trivially_copyable<CapabilityRecord>::value,
+              "CapabilityRecord is sent as raw bytes");
+
+// Consumer's answer to the producer's capability record.
+struct HandshakeReply {
+  CapabilityRecord caps;
+  uint8_t transport; // Transport picked by the consumer, kNone on failure
+  uint8_t peer_access; // Consumer device can access the producer device
+  uint8_t reserved[2];
+  uint32_t usable_transports; // Every transport whose requirements hold
+};
+static_assert(std::is_trivially_copyable<HandshakeReply>::value,
+              "HandshakeReply is sent as raw bytes");
+
+// Header sent for every tensor; followed by `nbytes` of payload when the
+// transport is kStagedCopy. Mapped tensors live at `offset` inside the
+// producer allocation `alloc_id`, whose handle is `handle`; every tensor of
+// the same allocation carries the same handle.
+struct TensorDescriptor {
+  int32_t index;
+  uint8_t transport;
+  uint8_t path; // DeliveryPath chosen by the producer's cost model
+  uint8_t lane;  // Priority lane the descriptor was sent on, 0 is most urgent
+  uint8_t dtype; // DType of the elements
+  uint64_t nbytes;
+  int32_t alloc_id; // Producer allocation id, negative when not mapped
+  uint32_t tenant;  // Tenant the tensor is accounted to on the consumer
+  uint64_t offset;
+  uint64_t deadline_ns; // CLOCK_MONOTONIC deadline, 0 when there is none
+  uint32_t flags;       // kDescriptor* bits
+  uint32_t crc32c;      // CRC32C of the tensor bytes with kDescriptorHasCrc
+  uint8_t handle[64];   // cudaIpcMemHandle_t or HostIpcHandle
+};
+static_assert(std::is_trivially_copyable<TensorDescriptor>::value,
+              "TensorDescriptor is sent as raw bytes");
+
+// The descriptor carries a CRC32C of the tensor's bytes. It is only set for
+// tensors whose bytes pass through host memory.
+constexpr uint32_t kDescriptorHasCrc = 1u << 0;
+
+// A descriptor with this index ends the stream; its `nbytes` holds the
+// number of tensors that were sent. It always travels on lane 0.
+constexpr int32_t kEndOfStreamIndex = -1;
+
+// A descriptor with this index asks the consumer to unmap every idle mapping
+// it keeps cached, e.g. because the producer paused on its watermark. It
+// carries no tensor and always travels on lane 0.
+constexpr int32_t kReleaseIdleIndex = -2;
+
+enum class BackMessageType : uint8_t {
+  kConsumerDone = 1,
+  kCostFeedback = 2, // Consumer-side cost of one tensor; also releases
+                     // pooled staging slots
+  kRelease = 3,      // `index` holds a count of ReleaseRecords that
+                     // follow; the consumer no longer maps those allocations
+  kDropped = 4,      // Tensor `index` expired and was never materialized;
+                     // releases its pooled staging slot
+};
+
+// Fixed-size message sent by the consumer on the consumer -> producer pipe
+// after the handshake reply.
+struct BackMessage {
+  uint8_t type;
+  uint8_t path;
+  uint8_t cache_hit;
+  uint8_t reserved;
+  int32_t index;
+  uint64_t nbytes;
+  uint64_t consumer_ns;
+};
+static_assert(std::is_trivially_copyable<BackMessage>::value,
+              "BackMessage is sent as raw bytes");
+
+// The consumer unmapped allocation `id` after it served `count` descriptors.
+struct ReleaseRecord {
+  int32_t id;
+  uint32_t count;
+};
+
+// Largest release batch that still fits one atomic pipe write, so messages
+// from several consumer threads never interleave.
+constexpr size_t kMaxReleaseBatch =
+    (PIPE_BUF - sizeof(BackMessage)) / sizeof(ReleaseRecord);
+
+// Inputs to negotiation that are only known on the consumer side.
+struct NegotiationContext {
+  bool peer_access; // Consumer device can reach the producer's device memory
+};
+
+// -----------------------------------------------------------------------------
+// Pipe I/O
+// -----------------------------------------------------------------------------
+
+inline void writeExact(int fd, const void *data, size_t size,
+                       const char *what) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      throw std::runtime_error(std::string("Failed to write ") + what);
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+}
+
+inline void readExact(int fd, void *data, size_t size, const char *what) {
+  char *p = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      throw std::runtime_error(std::string("Failed to read ") + what);
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+}
+
+inline void writeReleaseBatch(int fd, const ReleaseRecord *records,
+                              size_t count) {
+  if (count > kMaxReleaseBatch) {
+    throw std::runtime_error("Release batch too large");
+  }
+  char buffer[PIPE_BUF];
+  BackMessage msg{};
+  msg.type = static_cast<uint8_t>(BackMessageType::kRelease);
+  msg.index = static_cast<int32_t>(count);
+  memcpy(buffer, &msg, sizeof(msg));
+  memcpy(buffer + sizeof(msg), records, count * sizeof(ReleaseRecord));
+  writeExact(fd, buffer, sizeof(msg) + count * sizeof(ReleaseRecord),
+             "release batch");
+}
+
+// -----------------------------------------------------------------------------
+// Local capability discovery
+// -----------------------------------------------------------------------------
+
+inline uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : s) {
+    h = (h ^ c) * 1099511628211ull;
+  }
+  return h;
+}
+
+inline std::string readFirstLine(const char *path) {
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+inline uint64_t namespaceInode(const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(st.st_ino);
+}
+
+inline bool shmemHugePagesAvailable() {
+  std::string mode =
+      readFirstLine("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+  return mode.find("[always]") != std::string::npos ||
+         mode.find("[advise]") != std::string::npos ||
+         mode.find("[within_size]") != std::string::npos;
+}
+
+// Fills in the host-side fields; the caller sets backends, transports and the
+// device identity.
+inline CapabilityRecord localCapabilities() {
+  CapabilityRecord caps{};
+  caps.magic = kProtocolMagic;
+  caps.version = kProtocolVersion;
+  caps.min_version = kMinProtocolVersion;
+  caps.boot_id_hash = fnv1a(readFirstLine("/proc/sys/kernel/random/boot_id"));
+  char hostname[256] = {0};
+  gethostname(hostname, sizeof(hostname) - 1);
+  caps.hostname_hash = fnv1a(hostname);
+  caps.ipc_ns_inode = namespaceInode("/proc/self/ns/ipc");
+  caps.pid_ns_inode = namespaceInode("/proc/self/ns/pid");
+  caps.device = -1;
+  caps.huge_pages = shmemHugePagesAvailable() ? 1 : 0;
+  return caps;
+}
+
+inline void validateCapabilities(const CapabilityRecord &remote) {
+  if (remote.magic != kProtocolMagic) {
+    throw std::runtime_error("Peer is not speaking the CUDA IPC protocol");
+  }
+  if (remote.version < kMinProtocolVersion ||
+      remote.min_version > kProtocolVersion) {
+    throw std::runtime_error(
+        "Protocol version mismatch: local " + std::to_string(kProtocolVersion) +
+        " (min " + std::to_string(kMinProtocolVersion) + "), peer " +
+        std::to_string(remote.version) + " (min " +
+        std::to_string(remote.min_version) + ")");
+  }
+}
+
+inline bool sameHost(const CapabilityRecord &a, const CapabilityRecord &b) {
+  return a.boot_id_hash == b.boot_id_hash &&
+         a.hostname_hash == b.hostname_hash;
+}
+
+inline bool sameIpcNamespace(const CapabilityRecord &a,
+                             const CapabilityRecord &b) {
+  return sameHost(a, b) && a.ipc_ns_inode != 0 &&
+         a.ipc_ns_inode == b.ipc_ns_inode;
+}
+
+// The CUDA driver identifies the exporting process by pid when a handle is
+// opened, and the fd-passing transports reach the peer through its pid, so
+// the device transports also need both sides in one PID namespace.
+inline bool samePidNamespace(const CapabilityRecord &a,
+                             const CapabilityRecord &b) {
+  return sameHost(a, b) && a.pid_ns_inode != 0 &&
+         a.pid_ns_inode == b.pid_ns_inode;
+}
+
+// Returns the bitmask of transports both sides implement and whose
+// environmental requirements hold.
+inline uint32_t usableTransports(const CapabilityRecord &local,
+                                 const CapabilityRecord &remote,
+                                 const NegotiationContext &ctx) {
+  uint32_t common = local.transports & remote.transports;
+  bool both_cuda = (local.backends & kBackendCuda) &&
+                   (remote.backends & kBackendCuda);
+  uint32_t usable = 0;
+  for (Transport t : kTransportPreference) {
+    if (!(common & transportBit(t))) {
+      continue;
+    }
+    switch (t) {
+    case Transport::kCudaIpc:
+    case Transport::kVmmFd:
+    case Transport::kPoolExport:
+      if (both_cuda && sameIpcNamespace(local, remote) &&
+          samePidNamespace(local, remote) && ctx.peer_access) {
+        usable |= transportBit(t);
+      }
+      break;
+    case Transport::kHostShm:
+      if (sameIpcNamespace(local, remote)) {
+        usable |= transportBit(t);
+      }
+      break;
+    case Transport::kStagedCopy:
+      usable |= transportBit(t);
+      break;
+    default:
+      break;
+    }
+  }
+  return usable;
+}
+
+// Returns the fastest usable transport, or kNone.
+inline Transport negotiateTransport(const CapabilityRecord &local,
+                                    const CapabilityRecord &remote,
+                                    const NegotiationContext &ctx) {
+  uint32_t usable = usableTransports(local, remote, ctx);
+  for (Transport t : kTransportPreference) {
+    if (usable & transportBit(t)) {
+      return t;
+    }
+  }
+  return Transport::kNone;
+}
+
+} // namespace ipc
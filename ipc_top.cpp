@@ -0,0 +1,320 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// ipc-top: live view of a running sample
+//
+// Attaches read-only to the stats segment the sample's parent process
+// creates (see stats_segment.h) and prints per-worker rates, gauges and
+// per-stage latencies, and the consumer's per-tenant counters, once per
+// interval. Reading the segment never touches the workers' hot path.
+//
+//   ipc-top [--pid PARENT_PID | --name /SEGMENT] [--interval-ms 1000]
+//           [--count N]
+//
+// Without --pid or --name, the only cipc-stats segment in /dev/shm is used.
+// Latency percentiles are the upper bounds of the power-of-two histogram
+// buckets that hold them, over the last interval.
+// =============================================================================
+
+#include "stats_segment.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+  std::string name;
+  int interval_ms = 1000;
+  int count = 0; // Refreshes before exiting, 0 for no limit
+};
+
+Options parseOptions(int argc, char *argv[]) {
+  Options o;
+  for (int k = 1; k < argc; ++k) {
+    std::string arg = argv[k];
+    if (k + 1 >= argc) {
+      throw std::runtime_error("Missing value for " + arg);
+    }
+    std::string value = argv[++k];
+    if (arg == "--pid") {
+      o.name = ipc::defaultStatsName(atoi(value.c_str()));
+    } else if (arg == "--name") {
+      o.name = value;
+    } else if (arg == "--interval-ms") {
+      o.interval_ms = std::max(10, atoi(value.c_str()));
+    } else if (arg == "--count") {
+      o.count = std::max(0, atoi(value.c_str()));
+    } else {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+  }
+  return o;
+}
+
+// The single stats segment in /dev/shm, for runs without --pid or --name
+std::string findSegment() {
+  DIR *dir = opendir("/dev/shm");
+  if (dir == nullptr) {
+    throw std::runtime_error("Cannot list /dev/shm; pass --pid or --name");
+  }
+  std::vector<std::string> found;
+  while (struct dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "cipc-stats-", 11) == 0) {
+      found.push_back(std::string("/") + entry->d_name);
+    }
+  }
+  closedir(dir);
+  if (found.size() != 1) {
+    throw std::runtime_error(
+        std::to_string(found.size()) +
+        " stats segments found; pass --pid or --name to pick one");
+  }
+  return found[0];
+}
+
+// Plain copy of a worker's slot at one point in time
+struct Snapshot {
+  int32_t pid = 0;
+  uint64_t tensors = 0, bytes = 0, dropped = 0, hits = 0, misses = 0;
+  uint64_t integrity_failures = 0;
+  uint64_t in_flight = 0, open_mappings = 0, queue_depth = 0;
+  uint64_t stage_count[ipc::kStages] = {};
+  uint64_t stage_sum_ns[ipc::kStages] = {};
+  uint64_t stage_buckets[ipc::kStages][ipc::kLatencyBuckets] = {};
+};
+
+Snapshot snapshot(const ipc::WorkerStats &w) {
+  Snapshot s;
+  s.pid = w.pid.load(std::memory_order_relaxed);
+  s.tensors = ipc::statGet(w.tensors);
+  s.bytes = ipc::statGet(w.bytes);
+  s.dropped = ipc::statGet(w.dropped);
+  s.hits = ipc::statGet(w.cache_hits);
+  s.misses = ipc::statGet(w.cache_misses);
+  s.integrity_failures = ipc::statGet(w.integrity_failures);
+  s.in_flight = ipc::statGet(w.in_flight);
+  s.open_mappings = ipc::statGet(w.open_mappings);
+  s.queue_depth = ipc::statGet(w.queue_depth);
+  for (int k = 0; k < ipc::kStages; ++k) {
+    s.stage_count[k] = ipc::statGet(w.stages[k].count);
+    s.stage_sum_ns[k] = ipc::statGet(w.stages[k].sum_ns);
+    for (int b = 0; b < ipc::kLatencyBuckets; ++b) {
+      s.stage_buckets[k][b] = ipc::statGet(w.stages[k].buckets[b]);
+    }
+  }
+  return s;
+}
+
+// Plain copy of the consumer's published tenant slots
+struct TenantSnapshot {
+  uint32_t count = 0;
+  uint32_t id[ipc::kStatsTenants] = {};
+  uint64_t queued[ipc::kStatsTenants] = {};
+  uint64_t dispatched[ipc::kStatsTenants] = {};
+  uint64_t dispatched_bytes[ipc::kStatsTenants] = {};
+  uint64_t expired[ipc::kStatsTenants] = {};
+  uint64_t quota_blocked[ipc::kStatsTenants] = {};
+  uint64_t held_bytes[ipc::kStatsTenants] = {};
+  uint64_t held_handles[ipc::kStatsTenants] = {};
+};
+
+TenantSnapshot snapshotTenants(const ipc::StatsLayout &layout) {
+  TenantSnapshot s;
+  s.count = std::min<uint32_t>(
+      layout.tenant_count.load(std::memory_order_acquire), ipc::kStatsTenants);
+  for (uint32_t t = 0; t < s.count; ++t) {
+    const ipc::TenantStats &slot = layout.tenants[t];
+    s.id[t] = slot.id.load(std::memory_order_relaxed);
+    s.queued[t] = ipc::statGet(slot.queued);
+    s.dispatched[t] = ipc::statGet(slot.dispatched);
+    s.dispatched_bytes[t] = ipc::statGet(slot.dispatched_bytes);
+    s.expired[t] = ipc::statGet(slot.expired);
+    s.quota_blocked[t] = ipc::statGet(slot.quota_blocked);
+    s.held_bytes[t] = ipc::statGet(slot.held_bytes);
+    s.held_handles[t] = ipc::statGet(slot.held_handles);
+  }
+  return s;
+}
+
+// Upper bound in microseconds of the bucket holding quantile `q` of the
+// samples recorded between two snapshots, or 0 without samples
+uint64_t quantileUs(const Snapshot &now, const Snapshot &then, int stage,
+                    double q) {
+  const uint64_t total = now.stage_count[stage] - then.stage_count[stage];
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+  uint64_t seen = 0;
+  for (int b = 0; b < ipc::kLatencyBuckets; ++b) {
+    seen += now.stage_buckets[stage][b] - then.stage_buckets[stage][b];
+    if (seen >= rank) {
+      return ipc::latencyBucketUs(b);
+    }
+  }
+  return ipc::latencyBucketUs(ipc::kLatencyBuckets - 1);
+}
+
+bool alive(int32_t pid) {
+  return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+void render(const std::string &name, const ipc::StatsLayout &layout,
+            const Snapshot (&now)[ipc::kStatsRoles],
+            const Snapshot (&then)[ipc::kStatsRoles],
+            const TenantSnapshot &tenants_now,
+            const TenantSnapshot &tenants_then, double seconds,
+            double uptime) {
+  if (isatty(STDOUT_FILENO)) {
+    printf("\033[H\033[2J");
+  }
+  printf("ipc-top  %s  parent %d  up %.1f s\n\n", name.c_str(),
+         layout.parent_pid, uptime);
+  printf("%-9s %7s %5s %10s %9s %10s %8s %9s %8s %6s %6s\n", "worker", "pid",
+         "state", "tensors/s", "MB/s", "total", "dropped", "in-flight",
+         "mappings", "queue", "hit%");
+  for (int r = 0; r < ipc::kStatsRoles; ++r) {
+    const Snapshot &n = now[r];
+    const Snapshot &t = then[r];
+    const uint64_t lookups = n.hits + n.misses;
+    printf("%-9s %7d %5s %10.0f %9.1f %10llu %8llu %9llu %8llu %6llu %6.1f\n",
+           ipc::statsRoleName(static_cast<ipc::StatsRole>(r)), n.pid,
+           n.pid == 0 ? "-" : alive(n.pid) ? "run" : "exit",
+           (n.tensors - t.tensors) / seconds,
+           (n.bytes - t.bytes) / seconds / 1e6,
+           static_cast<unsigned long long>(n.tensors),
+           static_cast<unsigned long long>(n.dropped),
+           static_cast<unsigned long long>(n.in_flight),
+           static_cast<unsigned long long>(n.open_mappings),
+           static_cast<unsigned long long>(n.queue_depth),
+           lookups > 0 ? 100.0 * n.hits / lookups : 0.0);
+  }
+  printf("\n%-12s %10s %10s %10s %10s %10s\n", "stage", "count/s", "mean us",
+         "p50 <us", "p99 <us", "max <us");
+  for (int r = 0; r < ipc::kStatsRoles; ++r) {
+    for (int k = 0; k < ipc::kStages; ++k) {
+      const uint64_t count = now[r].stage_count[k] - then[r].stage_count[k];
+      if (now[r].stage_count[k] == 0) {
+        continue; // Not a stage of this worker
+      }
+      const uint64_t sum = now[r].stage_sum_ns[k] - then[r].stage_sum_ns[k];
+      printf("%-12s %10.0f %10.1f %10llu %10llu %10llu\n",
+             ipc::stageName(static_cast<ipc::Stage>(k)), count / seconds,
+             count > 0 ? sum / 1e3 / count : 0.0,
+             static_cast<unsigned long long>(
+                 quantileUs(now[r], then[r], k, 0.5)),
+             static_cast<unsigned long long>(
+                 quantileUs(now[r], then[r], k, 0.99)),
+             static_cast<unsigned long long>(
+                 quantileUs(now[r], then[r], k, 1.0)));
+    }
+  }
+  if (tenants_now.count > 0) {
+    printf("\n%-8s %7s %10s %9s %10s %8s %8s %9s %8s\n", "tenant", "queued",
+           "tensors/s", "MB/s", "total", "expired", "blocked", "held MB",
+           "handles");
+  }
+  for (uint32_t t = 0; t < tenants_now.count; ++t) {
+    // Slots keep their tenant, and one published since the last refresh
+    // starts from zero
+    const bool seen = t < tenants_then.count;
+    const uint64_t dispatched =
+        tenants_now.dispatched[t] - (seen ? tenants_then.dispatched[t] : 0);
+    const uint64_t bytes = tenants_now.dispatched_bytes[t] -
+                           (seen ? tenants_then.dispatched_bytes[t] : 0);
+    const std::string id = tenants_now.id[t] == ipc::kOtherTenants
+                               ? "other"
+                               : std::to_string(tenants_now.id[t]);
+    printf("%-8s %7llu %10.0f %9.1f %10llu %8llu %8llu %9.1f %8llu\n",
+           id.c_str(), static_cast<unsigned long long>(tenants_now.queued[t]),
+           dispatched / seconds, bytes / seconds / 1e6,
+           static_cast<unsigned long long>(tenants_now.dispatched[t]),
+           static_cast<unsigned long long>(tenants_now.expired[t]),
+           static_cast<unsigned long long>(tenants_now.quota_blocked[t]),
+           tenants_now.held_bytes[t] / 1e6,
+           static_cast<unsigned long long>(tenants_now.held_handles[t]));
+  }
+  const uint64_t failures = now[0].integrity_failures +
+                            now[1].integrity_failures;
+  if (failures > 0) {
+    printf("\n%llu integrity failures\n",
+           static_cast<unsigned long long>(failures));
+  }
+  fflush(stdout);
+}
+
+double nowSeconds() { return ipc::monotonicNs() / 1e9; }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  try {
+    Options options = parseOptions(argc, argv);
+    if (options.name.empty()) {
+      options.name = findSegment();
+    }
+    ipc::StatsSegment segment(options.name, ipc::StatsAccess::kRead);
+    const ipc::StatsLayout &layout = segment.layout();
+
+    Snapshot then[ipc::kStatsRoles];
+    Snapshot now[ipc::kStatsRoles];
+    for (int r = 0; r < ipc::kStatsRoles; ++r) {
+      then[r] = snapshot(layout.workers[r]);
+    }
+    TenantSnapshot tenants_then = snapshotTenants(layout);
+    double then_s = nowSeconds();
+    for (int refresh = 0; options.count == 0 || refresh < options.count;
+         ++refresh) {
+      usleep(static_cast<useconds_t>(options.interval_ms) * 1000);
+      for (int r = 0; r < ipc::kStatsRoles; ++r) {
+        now[r] = snapshot(layout.workers[r]);
+      }
+      const TenantSnapshot tenants_now = snapshotTenants(layout);
+      const double now_s = nowSeconds();
+      render(options.name, layout, now, then, tenants_now, tenants_then,
+             now_s - then_s, now_s - layout.start_ns / 1e9);
+      if (!alive(layout.parent_pid)) {
+        printf("parent exited\n");
+        break;
+      }
+      std::copy(std::begin(now), std::end(now), std::begin(then));
+      tenants_then = tenants_now;
+      then_s = now_s;
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "ipc-top: %s\n", e.what());
+    return 2;
+  }
+}
@@ -0,0 +1,256 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Descriptor I/O on the lanes
+//
+// The producer's and the consumer's ends of the descriptor lanes, shared by
+// the sample, ipc_bench and steady_state_test:
+// - LaneWriter: sends a descriptor on its lane, followed by the payload of an
+//   inline copy from a buffer reused across tensors
+// - LaneReader: reads a descriptor and its payload into a PendingDescriptor,
+//   reusing the payload buffers of tensors that were already built
+// - LaneDoorbell: a page both workers map with the number of descriptors
+//   sent on each lane. The writer bumps a lane's count once a descriptor and
+//   its payload are in the pipe; the reader compares it with what it has
+//   read, so it can spin on shared memory instead of polling the pipes.
+//
+// Past warm-up neither end allocates. A payload larger than any buffer seen
+// so far grows one, like a fresh slab would; that growth runs under a
+// SteadyStatePause.
+// =============================================================================
+
+#pragma once
+
+#include "alloc_counter.h"
+#include "ipc_protocol.h"
+#include "monotonic_clock.h"
+#include "priority_lanes.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace ipc {
+
+// A descriptor that has been read off its lane but not processed yet. Inline
+// payloads are read along with it so the lane can be drained ahead.
+struct PendingDescriptor {
+  TensorDescriptor desc;
+  std::vector<char> payload;
+  uint64_t read_ns = 0; // When the descriptor came off its lane
+};
+
+class LaneDoorbell {
+public:
+  // Creates the shared file for the parent to hand to both workers. It is
+  // inherited across exec; each worker maps it with the constructor below.
+  static int create() {
+    const int fd = memfd_create("cipc-lanes", 0);
+    if (fd < 0) {
+      throw std::runtime_error(std::string("memfd_create failed: ") +
+                               strerror(errno));
+    }
+    if (ftruncate(fd, sizeof(Counts)) != 0) {
+      const int err = errno;
+      close(fd);
+      throw std::runtime_error(std::string("ftruncate failed: ") +
+                               strerror(err));
+    }
+    return fd;
+  }
+
+  explicit LaneDoorbell(int fd) {
+    void *mem = mmap(nullptr, sizeof(Counts), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error(std::string("mmap of lane doorbell failed: ") +
+                               strerror(errno));
+    }
+    counts_ = static_cast<Counts *>(mem);
+  }
+
+  LaneDoorbell(const LaneDoorbell &) = delete;
+  LaneDoorbell &operator=(const LaneDoorbell &) = delete;
+
+  ~LaneDoorbell() { munmap(counts_, sizeof(Counts)); }
+
+  // Counts one more complete descriptor on `lane`. Only LaneWriter rings, so
+  // anything else written on a lane, like the handshake, is not counted.
+  void ring(int lane) {
+    counts_->lanes[lane].sent.fetch_add(1, std::memory_order_release);
+  }
+
+  uint64_t sent(int lane) const {
+    return counts_->lanes[lane].sent.load(std::memory_order_acquire);
+  }
+
+private:
+  // One cache line per lane, so the writer of one lane does not invalidate
+  // the line the reader spins on for another
+  struct alignas(64) Lane {
+    std::atomic<uint64_t> sent;
+  };
+  struct Counts {
+    Lane lanes[kMaxLanes];
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "the counts are shared between processes");
+
+  Counts *counts_;
+};
+
+class LaneWriter {
+public:
+  // Rings `doorbell`, when given, after every descriptor
+  explicit LaneWriter(std::vector<int> fds, LaneDoorbell *doorbell = nullptr)
+      : fds_(std::move(fds)), doorbell_(doorbell) {}
+
+  int lanes() const { return static_cast<int>(fds_.size()); }
+  int fd(int lane) const { return fds_[lane]; }
+
+  // Buffer of at least `size` bytes to copy an inline payload into before
+  // send().
+  char *payload(size_t size) {
+    if (payload_.size() < size) {
+      SteadyStatePause growth;
+      payload_.resize(size);
+    }
+    return payload_.data();
+  }
+
+  // Sends `desc` on its lane, followed by the first `payload_bytes` of the
+  // payload buffer.
+  void send(const TensorDescriptor &desc, size_t payload_bytes = 0) {
+    const int fd = fds_[desc.lane];
+    writeExact(fd, &desc, sizeof(desc), "tensor descriptor");
+    if (payload_bytes > 0) {
+      writeExact(fd, payload_.data(), payload_bytes, "tensor payload");
+    }
+    if (doorbell_ != nullptr) {
+      doorbell_->ring(desc.lane);
+    }
+  }
+
+private:
+  std::vector<int> fds_;
+  LaneDoorbell *doorbell_;
+  std::vector<char> payload_;
+};
+
+class LaneReader {
+public:
+  static constexpr size_t kMaxSpares = 64;
+
+  // Compares `doorbell`, when given, with the descriptors read so far
+  explicit LaneReader(std::vector<int> fds,
+                      const LaneDoorbell *doorbell = nullptr)
+      : fds_(std::move(fds)), doorbell_(doorbell), read_(fds_.size(), 0) {
+    spares_.reserve(kMaxSpares);
+  }
+
+  int lanes() const { return static_cast<int>(fds_.size()); }
+  const std::vector<int> &fds() const { return fds_; }
+  bool hasDoorbell() const { return doorbell_ != nullptr; }
+
+  // A bit per lane whose doorbell counts descriptors that were not read yet.
+  // No system call; a hung up lane only shows up in poll().
+  uint32_t pending() const {
+    uint32_t ready = 0;
+    for (size_t lane = 0; lane < read_.size(); ++lane) {
+      if (doorbell_->sent(static_cast<int>(lane)) > read_[lane]) {
+        ready |= 1u << lane;
+      }
+    }
+    return ready;
+  }
+
+  // Reads the next descriptor off `lane` into `pending`, with its payload
+  // when it is an inline copy. Markers such as kEndOfStreamIndex are read
+  // like any other descriptor; telling them apart is up to the caller.
+  void read(int lane, PendingDescriptor &pending) {
+    const int fd = fds_[lane];
+    readExact(fd, &pending.desc, sizeof(pending.desc), "tensor descriptor");
+    if (pending.desc.index >= 0 &&
+        pending.desc.transport ==
+            static_cast<uint8_t>(Transport::kStagedCopy)) {
+      takeSpare(pending.payload, pending.desc.nbytes);
+      readExact(fd, pending.payload.data(), pending.payload.size(),
+                "tensor payload");
+    }
+    ++read_[lane];
+    pending.read_ns = monotonicNs();
+  }
+
+  // Hands a payload buffer back for a later descriptor once its bytes are no
+  // longer needed, and leaves `payload` empty.
+  void recycle(std::vector<char> &payload) {
+    if (payload.capacity() > 0 && spares_.size() < kMaxSpares) {
+      spares_.push_back(std::move(payload));
+    }
+    payload = std::vector<char>();
+  }
+
+private:
+  // Sizes `payload` to `need` bytes with the smallest spare that fits, else
+  // the largest one
+  void takeSpare(std::vector<char> &payload, size_t need) {
+    size_t pick = spares_.size();
+    for (size_t i = 0; i < spares_.size(); ++i) {
+      if (pick == spares_.size()) {
+        pick = i;
+        continue;
+      }
+      const size_t have = spares_[pick].capacity();
+      const size_t cand = spares_[i].capacity();
+      if (have >= need ? cand >= need && cand < have : cand > have) {
+        pick = i;
+      }
+    }
+    if (pick < spares_.size()) {
+      payload = std::move(spares_[pick]);
+      spares_[pick] = std::move(spares_.back());
+      spares_.pop_back();
+    }
+    if (payload.capacity() < need) {
+      SteadyStatePause growth;
+      payload.reserve(need);
+    }
+    payload.resize(need);
+  }
+
+  std::vector<int> fds_;
+  const LaneDoorbell *doorbell_;
+  std::vector<uint64_t> read_; // Descriptors read per lane
+  std::vector<std::vector<char>> spares_;
+};
+
+} // namespace ipc
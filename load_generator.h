@@ -0,0 +1,225 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Synthetic load generation
+//
+// Draws tensor sizes, element types and inter-arrival gaps from configurable
+// distributions so the producer can reproduce a production traffic shape.
+// Value distributions are written as `kind:params`:
+//   fixed:V                  always V
+//   uniform:LO:HI            uniform in [LO, HI]
+//   lognormal:MEDIAN:SIGMA   log-normal around MEDIAN
+//   bursty:ON:OFF:VON:VOFF   VON for ON draws, then VOFF for OFF draws
+//   trace:PATH               values from a text file, one per line, cycled
+// Element types are a comma separated list of `name[:weight]`.
+// =============================================================================
+
+#pragma once
+
+#include "ipc_protocol.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ipc {
+
+class ValueDistribution {
+public:
+  enum class Kind { kFixed, kUniform, kLognormal, kBursty, kTrace };
+
+  static ValueDistribution parse(const std::string &spec) {
+    ValueDistribution d;
+    // A trace path is taken whole, ':' included
+    if (spec.compare(0, 6, "trace:") == 0 && spec.size() > 6) {
+      const std::string path = spec.substr(6);
+      d.kind_ = Kind::kTrace;
+      std::ifstream in(path);
+      if (!in) {
+        throw std::runtime_error("Cannot open trace " + path + ": " +
+                                 strerror(errno));
+      }
+      double v;
+      while (in >> v) {
+        d.trace_.push_back(v);
+      }
+      if (d.trace_.empty()) {
+        throw std::runtime_error("Trace " + path + " holds no values");
+      }
+      return d;
+    }
+    std::vector<std::string> parts = split(spec, ':');
+    const std::string &kind = parts[0];
+    std::vector<double> params;
+    for (size_t k = 1; k < parts.size(); ++k) {
+      char *end = nullptr;
+      params.push_back(strtod(parts[k].c_str(), &end));
+      if (parts[k].empty() || *end != '\0') {
+        throw std::runtime_error("Invalid distribution: " + spec);
+      }
+    }
+    if (kind == "fixed" && params.size() == 1) {
+      d.kind_ = Kind::kFixed;
+    } else if (kind == "uniform" && params.size() == 2) {
+      d.kind_ = Kind::kUniform;
+    } else if (kind == "lognormal" && params.size() == 2 && params[0] > 0) {
+      d.kind_ = Kind::kLognormal;
+      params[0] = std::log(params[0]);
+    } else if (kind == "bursty" && params.size() == 4 &&
+               params[0] + params[1] > 0) {
+      d.kind_ = Kind::kBursty;
+    } else {
+      throw std::runtime_error("Invalid distribution: " + spec);
+    }
+    for (size_t k = 0; k < params.size(); ++k) {
+      d.params_[k] = params[k];
+    }
+    return d;
+  }
+
+  double sample(std::mt19937_64 &rng) {
+    switch (kind_) {
+    case Kind::kFixed:
+      return params_[0];
+    case Kind::kUniform:
+      return std::uniform_real_distribution<double>(params_[0],
+                                                    params_[1])(rng);
+    case Kind::kLognormal:
+      return std::lognormal_distribution<double>(params_[0], params_[1])(rng);
+    case Kind::kBursty: {
+      const uint64_t on = static_cast<uint64_t>(params_[0]);
+      const uint64_t period = on + static_cast<uint64_t>(params_[1]);
+      return (draws_++ % period) < on ? params_[2] : params_[3];
+    }
+    case Kind::kTrace:
+      return trace_[draws_++ % trace_.size()];
+    }
+    return 0;
+  }
+
+  static std::vector<std::string> split(const std::string &text, char sep) {
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    for (;;) {
+      size_t end = text.find(sep, pos);
+      parts.push_back(text.substr(pos, end - pos));
+      if (end == std::string::npos) {
+        return parts;
+      }
+      pos = end + 1;
+    }
+  }
+
+private:
+  Kind kind_ = Kind::kFixed;
+  double params_[4] = {0, 0, 0, 0};
+  std::vector<double> trace_;
+  uint64_t draws_ = 0;
+};
+
+struct LoadItem {
+  uint64_t arrival_ns;  // Offset from the start of the run
+  uint64_t nbytes;      // Whole number of elements, at least one
+  DType dtype;
+  int64_t tenant;       // Negative to let the producer assign one
+  uint64_t deadline_ns; // Deadline budget, 0 for the producer's default
+  int32_t lane;         // Negative to pick one by size
+  int32_t path;         // DeliveryPath, negative to let the cost model pick
+};
+
+class LoadGenerator {
+public:
+  // Stops after `count` items, or once arrivals pass `duration_ns`; zero
+  // disables either limit (but not both).
+  LoadGenerator(const std::string &size_spec, const std::string &arrival_spec,
+                const std::string &dtype_spec, uint64_t count,
+                uint64_t duration_ns, uint64_t seed)
+      : sizes_(ValueDistribution::parse(size_spec)),
+        gaps_(ValueDistribution::parse(arrival_spec)), count_(count),
+        duration_ns_(duration_ns), rng_(seed) {
+    if (count_ == 0 && duration_ns_ == 0) {
+      throw std::runtime_error("Load generator needs a count or a duration");
+    }
+    std::vector<double> weights;
+    for (const std::string &entry : ValueDistribution::split(dtype_spec, ',')) {
+      std::vector<std::string> parts = ValueDistribution::split(entry, ':');
+      DType dtype;
+      if (!dtypeFromName(parts[0], dtype) || parts.size() > 2) {
+        throw std::runtime_error("Invalid dtype: " + entry);
+      }
+      dtypes_.push_back(dtype);
+      weights.push_back(parts.size() == 2 ? std::stod(parts[1]) : 1.0);
+    }
+    dtype_pick_ = std::discrete_distribution<size_t>(weights.begin(),
+                                                     weights.end());
+  }
+
+  // Produces the next item; false once the run is over. The first item
+  // arrives at offset zero.
+  bool next(LoadItem &item) {
+    if (count_ != 0 && generated_ == count_) {
+      return false;
+    }
+    if (generated_ > 0) {
+      // Gaps are given in microseconds
+      clock_ns_ += static_cast<uint64_t>(
+          std::max(0.0, gaps_.sample(rng_)) * 1000.0);
+    }
+    if (duration_ns_ != 0 && clock_ns_ >= duration_ns_) {
+      return false;
+    }
+    item.arrival_ns = clock_ns_;
+    item.tenant = -1;
+    item.deadline_ns = 0;
+    item.lane = -1;
+    item.path = -1;
+    item.dtype = dtypes_[dtype_pick_(rng_)];
+    const uint64_t elem = dtypeSize(item.dtype);
+    const double bytes = std::max(0.0, sizes_.sample(rng_));
+    item.nbytes = std::max<uint64_t>(1, static_cast<uint64_t>(bytes) / elem) *
+                  elem;
+    ++generated_;
+    return true;
+  }
+
+private:
+  ValueDistribution sizes_;
+  ValueDistribution gaps_;
+  std::vector<DType> dtypes_;
+  std::discrete_distribution<size_t> dtype_pick_;
+  uint64_t count_;
+  uint64_t duration_ns_;
+  std::mt19937_64 rng_;
+  uint64_t clock_ns_ = 0;
+  uint64_t generated_ = 0;
+};
+
+} // namespace ipc
@@ -0,0 +1,67 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Allocation-free log lines
+//
+// Formats a log line into a fixed per-thread buffer and writes it in one go,
+// so logging from the per-tensor loops does not allocate. Longer lines are
+// truncated.
+// =============================================================================
+
+#pragma once
+
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+
+namespace ipc {
+
+class LogLine : private std::streambuf {
+public:
+  LogLine() : stream_(this) {}
+
+  std::ostream &start() {
+    setp(text_, text_ + sizeof(text_));
+    return stream_;
+  }
+
+  void finish(std::ostream &out = std::cout) {
+    out.write(text_, pptr() - text_);
+    out << std::endl;
+  }
+
+  static LogLine &current() {
+    static thread_local LogLine line;
+    return line;
+  }
+
+private:
+  int overflow(int ch) override { return traits_type::not_eof(ch); }
+
+  char text_[512];
+  std::ostream stream_;
+};
+
+} // namespace ipc
@@ -34,103 +34,1224 @@
 // - Consumer process accesses shared GPU memory without copy
 // - Synchronization using pipe-based signaling
 // - Error handling and robust data transfer
+// - Versioned capability handshake that picks the fastest shared transport
+//   (CUDA IPC, host shared memory or staged copy)
+// - Optional dynamic batching of received tensors
+// - Priority lanes so small tensors never wait behind bulk ones
+// - FIFO, deficit round robin or earliest-deadline-first scheduling of
+//   received descriptors, with per-tenant quotas
+// - Token bucket rate limiting and watermark admission in the producer
+// - Load generator with configurable size, dtype and arrival distributions
+// - Recording and replay of descriptor traffic
+// - Profiled GPU costs, captured on CUDA runs and injected by the host backend
+// - Adaptive spin-then-block waits on the pipes, or busy polling
+// - Per-role CPU sets, NUMA binding near the GPU and a low-latency profile
+// - Allocation-free descriptor path in steady state, checked by a test
+// - Full or sampled verification of received tensors instead of printing
+// - Optional CRC32C of tensors that pass through host memory
+// - Live counters and stage latencies in shared memory, shown by ipc-top
+//   and exported in Prometheus text format by the parent
+// - USDT probes on the handle-transfer path (sys/sdt.h)
+// - Background prefetch of mappings for queued descriptors
 // =============================================================================
 
+#include "adaptive_spin.h"
+#include "alloc_counter.h"
+#include "crc32c.h"
+#include "deferred_reclaimer.h"
+#include "dynamic_batcher.h"
+#include "gpu_cost_profile.h"
+#include "handle_key.h"
+#include "host_backend.h"
+#include "ipc_protocol.h"
+#include "lane_io.h"
+#include "load_generator.h"
+#include "log_line.h"
+#include "mapping_table.h"
+#include "mapping_prefetcher.h"
+#include "metrics_exporter.h"
+#include "node_pool.h"
+#include "priority_lanes.h"
+#include "rate_limiter.h"
+#include "slab_allocator.h"
+#include "stats_segment.h"
+#include "tenant_scheduler.h"
+#define IPC_DEFINE_PROBE_SEMAPHORES // This file owns the probe semaphores
+#include "usdt_probes.h"
+#include "trace_file.h"
+#include "transport_cost_model.h"
+#include "worker_placement.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <cuda_runtime.h>
 #include <fcntl.h>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <poll.h>
 #include <spawn.h>
 #include <sstream>
 #include <sys/wait.h>
 #include <torch/torch.h>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 namespace {
 #define DEBUG_LOG(msg)                                                         \
   do {                                                                         \
-    std::ostringstream oss;                                                    \
-    oss << "[" << getpid() << "] " << msg;                                     \
-    std::cout << oss.str() << std::endl;                                       \
-    std::cout.flush();                                                         \
+    ipc::LogLine &line_ = ipc::LogLine::current();                             \
+    line_.start() << "[" << getpid() << "] " << msg;                           \
+    line_.finish();                                                            \
   } while (0)
 
-std::string cudaIpcHandleToString(const cudaIpcMemHandle_t &handle) {
-  const uint8_t *data = reinterpret_cast<const uint8_t *>(&handle);
-  std::string result = "0x";
-  for (int i = 0; i < sizeof(cudaIpcMemHandle_t); ++i) {
-    char res[3] = {0};
-    snprintf(res, sizeof(res), "%02X", static_cast<uint8_t>(data[i]));
-    result += std::string(res);
-  }
+// Hex text of a CUDA IPC handle, built without allocating
+struct HandleText {
+  char text[3 + 2 * sizeof(cudaIpcMemHandle_t)];
+};
+
+HandleText cudaIpcHandleToString(const cudaIpcMemHandle_t &handle) {
+  HandleText result = {{'0', 'x'}};
+  ipc::hexEncode(&handle, sizeof(handle), result.text + 2);
+  result.text[sizeof(result.text) - 1] = '\0';
   return result;
 }
+
+// Staging slots still owned by the consumer, by tensor index. Nodes come
+// from a pool so the steady state does not allocate.
+using StagedSlots =
+    std::unordered_map<int, void *, std::hash<int>, std::equal_to<int>,
+                       ipc::PoolAllocator<std::pair<const int, void *>>>;
+
+std::string envOr(const char *name, const std::string &fallback) {
+  const char *value = getenv(name);
+  return value != nullptr && *value != '\0' ? std::string(value) : fallback;
+}
+
+uint64_t envOr(const char *name, uint64_t fallback) {
+  const char *value = getenv(name);
+  return value != nullptr && *value != '\0' ? strtoull(value, nullptr, 0)
+                                             : fallback;
+}
+
+// IPC_BACKEND=cuda|host selects where this process keeps tensor memory.
+uint32_t localBackend() {
+  return envOr("IPC_BACKEND", "cuda") == "host" ? ipc::kBackendHost
+                                                : ipc::kBackendCuda;
+}
+
+// Where a worker of `role` runs. IPC_PRODUCER_CPUS and IPC_CONSUMER_CPUS
+// are CPU lists per role. IPC_NUMA_NODE binds memory to a node, or with
+// `gpu` to the node of the GPU's PCIe root; workers without a CPU list then
+// also run on that node's CPUs. IPC_LOW_LATENCY=1 adds SCHED_FIFO at
+// IPC_RT_PRIORITY and locks memory.
+ipc::WorkerPlacement workerPlacement(const std::string &role) {
+  ipc::WorkerPlacement placement;
+  std::string upper = role;
+  std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+  placement.cpus = ipc::parseCpuList(envOr(("IPC_" + upper + "_CPUS").c_str(),
+                                           ""));
+  const std::string node = envOr("IPC_NUMA_NODE", "");
+  if (node == "gpu") {
+    // Must not touch the CUDA runtime: the driver's threads would start
+    // before the placement is applied
+    const std::string bus_id = localBackend() == ipc::kBackendCuda
+                                   ? ipc::cudaDevice0BusId()
+                                   : std::string();
+    if (!bus_id.empty()) {
+      placement.numa_node = ipc::pciNumaNode(bus_id);
+    }
+    if (placement.numa_node < 0) {
+      DEBUG_LOG("No NUMA node known for the GPU, memory is not bound; with "
+                "several GPUs set CUDA_DEVICE_ORDER=PCI_BUS_ID or pick the "
+                "GPU by UUID in CUDA_VISIBLE_DEVICES");
+    }
+  } else if (!node.empty()) {
+    placement.numa_node = atoi(node.c_str());
+  }
+  if (placement.numa_node >= 0 && placement.cpus.empty()) {
+    placement.cpus = ipc::numaNodeCpus(placement.numa_node);
+  }
+  if (envOr("IPC_LOW_LATENCY", uint64_t(0)) != 0) {
+    placement.rt_priority =
+        static_cast<int>(envOr("IPC_RT_PRIORITY", uint64_t(10)));
+    placement.lock_memory = true;
+  }
+  return placement;
+}
+
+// Builds this process' capability record. IPC_TRANSPORT restricts the
+// advertised transports to a single one, which is handy for exercising the
+// slower paths on a machine where CUDA IPC works.
+ipc::CapabilityRecord localCapabilityRecord() {
+  ipc::CapabilityRecord caps = ipc::localCapabilities();
+  caps.backends = localBackend();
+  caps.transports = ipc::transportBit(ipc::Transport::kHostShm) |
+                    ipc::transportBit(ipc::Transport::kStagedCopy);
+  if (caps.backends & ipc::kBackendCuda) {
+    caps.transports |= ipc::transportBit(ipc::Transport::kCudaIpc);
+    int device = 0;
+    cudaDeviceProp prop;
+    if (cudaGetDevice(&device) == cudaSuccess &&
+        cudaGetDeviceProperties(&prop, device) == cudaSuccess) {
+      caps.device = device;
+      memcpy(caps.device_uuid, &prop.uuid, sizeof(caps.device_uuid));
+    }
+  }
+  std::string forced = envOr("IPC_TRANSPORT", "");
+  if (!forced.empty()) {
+    ipc::Transport t = ipc::transportFromName(forced);
+    if (t == ipc::Transport::kNone) {
+      throw std::runtime_error("Unknown IPC_TRANSPORT: " + forced);
+    }
+    caps.transports &= ipc::transportBit(t);
+  }
+  return caps;
+}
+
+// True when the current device can dereference memory living on the device
+// with the given UUID, either because it is the same device or through peer
+// access.
+bool canAccessDevice(const uint8_t (&uuid)[16]) {
+  int current = 0;
+  int count = 0;
+  if (cudaGetDevice(&current) != cudaSuccess ||
+      cudaGetDeviceCount(&count) != cudaSuccess) {
+    return false;
+  }
+  for (int d = 0; d < count; ++d) {
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, d) != cudaSuccess ||
+        memcmp(&prop.uuid, uuid, sizeof(uuid)) != 0) {
+      continue;
+    }
+    if (d == current) {
+      return true;
+    }
+    int can_access = 0;
+    cudaDeviceCanAccessPeer(&can_access, current, d);
+    return can_access != 0;
+  }
+  return false;
+}
+
+// Host backend copies stand in for the H2D and D2H copies of a GPU run and
+// are charged the profiled cost; device copies are timed for capture. With
+// `crc` set, the CRC32C of the host-side bytes is stored there; host copies
+// compute it while copying.
+void copyIn(void *dst, const void *src, size_t nbytes, bool on_device,
+            ipc::GpuCostProfile &costs, uint32_t *crc = nullptr) {
+  if (!on_device) {
+    if (crc != nullptr) {
+      *crc = ipc::crc32cCopy(dst, src, nbytes);
+    } else {
+      memcpy(dst, src, nbytes);
+    }
+    costs.inject(ipc::GpuCostProfile::kCopyH2D, nbytes);
+    return;
+  }
+  if (crc != nullptr) {
+    *crc = ipc::crc32c(src, nbytes);
+  }
+  uint64_t start_ns = ipc::monotonicNs();
+  cudaError_t err = cudaMemcpy(dst, src, nbytes, cudaMemcpyHostToDevice);
+  if (err != cudaSuccess) {
+    throw std::runtime_error("cudaMemcpy H2D failed: " +
+                             std::string(cudaGetErrorString(err)));
+  }
+  costs.record(ipc::GpuCostProfile::kCopyH2D, ipc::monotonicNs() - start_ns,
+               nbytes);
+}
+
+void copyOut(void *dst, const void *src, size_t nbytes, bool on_device,
+             ipc::GpuCostProfile &costs, uint32_t *crc = nullptr) {
+  if (!on_device) {
+    if (crc != nullptr) {
+      *crc = ipc::crc32cCopy(dst, src, nbytes);
+    } else {
+      memcpy(dst, src, nbytes);
+    }
+    costs.inject(ipc::GpuCostProfile::kCopyD2H, nbytes);
+    return;
+  }
+  uint64_t start_ns = ipc::monotonicNs();
+  cudaError_t err = cudaMemcpy(dst, src, nbytes, cudaMemcpyDeviceToHost);
+  if (err != cudaSuccess) {
+    throw std::runtime_error("cudaMemcpy D2H failed: " +
+                             std::string(cudaGetErrorString(err)));
+  }
+  if (crc != nullptr) {
+    *crc = ipc::crc32c(dst, nbytes);
+  }
+  costs.record(ipc::GpuCostProfile::kCopyD2H, ipc::monotonicNs() - start_ns,
+               nbytes);
+}
+
+// IPC_GPU_PROFILE makes the host backend charge the CUDA costs measured on
+// real hardware. On a CUDA run, IPC_PROFILE_CAPTURE measures those costs
+// instead; each process appends what it measured on exit.
+void configureCostProfile(ipc::GpuCostProfile &costs, ipc::HostBackend &host,
+                          bool on_device) {
+  const std::string profile = envOr("IPC_GPU_PROFILE", "");
+  if (!on_device && !profile.empty()) {
+    costs.load(profile);
+    host.setCostProfile(&costs);
+  }
+  if (on_device && !envOr("IPC_PROFILE_CAPTURE", "").empty()) {
+    costs.startCapture();
+  }
+}
+
+void saveCapturedCosts(const ipc::GpuCostProfile &costs) {
+  if (costs.capturing()) {
+    costs.appendCaptured(envOr("IPC_PROFILE_CAPTURE", ""));
+  }
+}
+
+torch::ScalarType torchDtype(ipc::DType dtype) {
+  switch (dtype) {
+  case ipc::DType::kInt32:
+    return torch::kInt32;
+  case ipc::DType::kInt64:
+    return torch::kInt64;
+  case ipc::DType::kUInt8:
+    return torch::kUInt8;
+  case ipc::DType::kFloat32:
+    return torch::kFloat32;
+  case ipc::DType::kFloat16:
+    return torch::kFloat16;
+  case ipc::DType::kBFloat16:
+    return torch::kBFloat16;
+  }
+  throw std::runtime_error("Unknown dtype " +
+                           std::to_string(static_cast<int>(dtype)));
+}
+
+// Contents of tensor #index at the given element positions: element k holds
+// index * (k + 1), converted to the tensor's dtype. The producer fills its
+// tensors with this and the consumer checks against it.
+torch::Tensor expectedContents(int64_t index, const torch::Tensor &positions,
+                               torch::ScalarType dtype) {
+  return positions.add(1).mul(index).to(dtype);
+}
+
+// Handle fingerprint reported by the USDT probes, 0 for copies
+uint64_t handleFingerprint(const ipc::TensorDescriptor &desc) {
+  return desc.transport == static_cast<uint8_t>(ipc::Transport::kStagedCopy)
+             ? 0
+             : ipc::hashHandleBytes(desc.handle);
+}
+
+// Delivery paths the producer may use once the transports are known.
+uint32_t allowedDeliveryPaths(uint32_t usable, bool on_device) {
+  uint32_t paths = 0;
+  if (usable & ipc::transportBit(ipc::Transport::kStagedCopy)) {
+    paths |= ipc::deliveryPathBit(ipc::DeliveryPath::kInlineCopy);
+  }
+  if (usable & ipc::transportBit(ipc::Transport::kHostShm)) {
+    paths |= ipc::deliveryPathBit(ipc::DeliveryPath::kPooledStaging);
+  }
+  if ((on_device && (usable & ipc::transportBit(ipc::Transport::kCudaIpc))) ||
+      (!on_device && (usable & ipc::transportBit(ipc::Transport::kHostShm)))) {
+    paths |= ipc::deliveryPathBit(ipc::DeliveryPath::kIpcMapping);
+  }
+  return paths;
+}
+
+// The single path implied by the negotiated transport, used when
+// IPC_TRANSPORT_POLICY=fixed.
+ipc::DeliveryPath fixedDeliveryPath(ipc::Transport transport, bool on_device) {
+  switch (transport) {
+  case ipc::Transport::kCudaIpc:
+    return ipc::DeliveryPath::kIpcMapping;
+  case ipc::Transport::kHostShm:
+    return on_device ? ipc::DeliveryPath::kPooledStaging
+                     : ipc::DeliveryPath::kIpcMapping;
+  default:
+    return ipc::DeliveryPath::kInlineCopy;
+  }
+}
+
+// Applies consumer feedback to the cost model, frees staging slots and the
+// slabs the consumer has unmapped or dropped, and keeps the in-flight gauge
+// in step with them. Returns true once the consumer's done message has been
+// seen. Without `block` only messages that are already queued are consumed.
+bool drainBackChannel(int fd, bool block, ipc::TransportCostModel &model,
+                      ipc::HostStagingPool &pool,
+                      StagedSlots &staged_slots,
+                      ipc::SlabAllocator &slabs, ipc::WorkerStats &stats) {
+  for (;;) {
+    if (!block) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN)) {
+        return false;
+      }
+    }
+    ipc::BackMessage msg;
+    ipc::readExact(fd, &msg, sizeof(msg), "consumer message");
+    if (msg.type == static_cast<uint8_t>(ipc::BackMessageType::kConsumerDone)) {
+      return true;
+    }
+    if (msg.type == static_cast<uint8_t>(ipc::BackMessageType::kRelease)) {
+      ipc::ReleaseRecord records[ipc::kMaxReleaseBatch];
+      size_t count = static_cast<size_t>(msg.index);
+      if (count > ipc::kMaxReleaseBatch) {
+        throw std::runtime_error("Malformed release batch");
+      }
+      ipc::readExact(fd, records, count * sizeof(ipc::ReleaseRecord),
+                     "release batch");
+      for (size_t k = 0; k < count; ++k) {
+        slabs.releaseRemote(records[k].id, records[k].count);
+      }
+      ipc::statSet(stats.in_flight, slabs.liveSlabs() + pool.busySlots());
+      continue;
+    }
+    auto slot = staged_slots.find(msg.index);
+    if (slot != staged_slots.end()) {
+      pool.release(slot->second);
+      staged_slots.erase(slot);
+      ipc::statSet(stats.in_flight, slabs.liveSlabs() + pool.busySlots());
+    }
+    if (msg.type == static_cast<uint8_t>(ipc::BackMessageType::kDropped)) {
+      continue;
+    }
+    auto path = static_cast<ipc::DeliveryPath>(msg.path);
+    model.record(path, ipc::TransportCostModel::Side::kConsumer, msg.nbytes,
+                 msg.consumer_ns);
+    if (path == ipc::DeliveryPath::kIpcMapping) {
+      model.recordCacheLookup(msg.nbytes, msg.consumer_ns,
+                              msg.cache_hit != 0);
+    }
+  }
+}
+
+// How the consumer waits for its lanes: IPC_SPIN=block|adaptive|busy_poll,
+// spinning for at most IPC_SPIN_MAX_US per wait in adaptive mode.
+ipc::AdaptiveSpin &receiveSpin() {
+  static ipc::AdaptiveSpin spin = [] {
+    ipc::SpinMode mode;
+    const std::string name = envOr("IPC_SPIN", "adaptive");
+    if (!ipc::spinModeFromName(name, mode)) {
+      throw std::runtime_error("Unknown IPC_SPIN: " + name);
+    }
+    return ipc::AdaptiveSpin(mode,
+                             envOr("IPC_SPIN_MAX_US", uint64_t(50)) * 1000);
+  }();
+  return spin;
+}
+
+// Prints how often the worker allocated on its steady-state path. With
+// IPC_CHECK_ALLOCATIONS=1 any such allocation fails the run. Allocations are
+// only counted in builds with IPC_COUNT_ALLOCATIONS, which replace the
+// global operator new.
+void checkSteadyStateAllocations(const char *role) {
+#ifndef IPC_DEFINE_ALLOCATION_HOOKS
+  if (envOr("IPC_CHECK_ALLOCATIONS", uint64_t(0)) != 0) {
+    throw std::runtime_error("IPC_CHECK_ALLOCATIONS needs a build with "
+                             "-DIPC_COUNT_ALLOCATIONS=ON");
+  }
+  (void)role;
+#else
+  const uint64_t count = ipc::steadyStateAllocations();
+  std::cout << role << " steady-state allocations: " << count << std::endl;
+  if (count > 0 && envOr("IPC_CHECK_ALLOCATIONS", uint64_t(0)) != 0) {
+    throw std::runtime_error(std::string(role) +
+                             " allocated on its steady-state path");
+  }
+#endif
+}
+
+// The parent's stats segment (IPC_STATS_NAME), or a private one when the
+// worker runs on its own or cannot open it.
+ipc::StatsLayout &statsLayout() {
+  static std::unique_ptr<ipc::StatsSegment> segment = [] {
+    const std::string name = envOr("IPC_STATS_NAME", "");
+    if (!name.empty()) {
+      try {
+        return std::make_unique<ipc::StatsSegment>(name,
+                                                   ipc::StatsAccess::kWrite);
+      } catch (const std::exception &e) {
+        fprintf(stderr, "warning: stats segment: %s; live stats disabled\n",
+                e.what());
+      }
+    }
+    return std::make_unique<ipc::StatsSegment>();
+  }();
+  return segment->layout();
+}
+
+// This worker's slot in the stats segment.
+ipc::WorkerStats &workerStats(ipc::StatsRole role) {
+  ipc::WorkerStats &stats = statsLayout().worker(role);
+  stats.pid.store(static_cast<int32_t>(getpid()), std::memory_order_relaxed);
+  return stats;
+}
+
+void setTenantStats(ipc::TenantStats &slot, const ipc::TenantCounters &c) {
+  ipc::statSet(slot.queued, c.queued);
+  ipc::statSet(slot.dispatched, c.delivered);
+  ipc::statSet(slot.dispatched_bytes, c.delivered_bytes);
+  ipc::statSet(slot.expired, c.expired);
+  ipc::statSet(slot.quota_blocked, c.quota_waits);
+  ipc::statSet(slot.held_bytes, c.held_bytes);
+  ipc::statSet(slot.held_handles, c.held_handles);
+}
+
+// Copies the scheduler's per-tenant counters into the segment's tenant
+// slots. A tenant keeps the slot it claimed first; once only the last slot
+// is left, it takes the sum of every tenant without a slot of its own.
+template <typename T>
+void publishTenantStats(const ipc::TenantScheduler<T> &scheduler,
+                        ipc::StatsLayout &layout) {
+  constexpr uint32_t kNamedSlots = ipc::kStatsTenants - 1;
+  uint32_t named = std::min(
+      layout.tenant_count.load(std::memory_order_relaxed), kNamedSlots);
+  ipc::TenantCounters other;
+  bool has_other = false;
+  scheduler.forEachTenant([&](uint32_t id, const ipc::TenantCounters &c) {
+    uint32_t slot = 0;
+    while (slot < named &&
+           layout.tenants[slot].id.load(std::memory_order_relaxed) != id) {
+      ++slot;
+    }
+    if (slot == named && named < kNamedSlots) {
+      layout.tenants[slot].id.store(id, std::memory_order_relaxed);
+      layout.tenant_count.store(++named, std::memory_order_release);
+    } else if (slot == named) {
+      other.queued += c.queued;
+      other.delivered += c.delivered;
+      other.delivered_bytes += c.delivered_bytes;
+      other.expired += c.expired;
+      other.quota_waits += c.quota_waits;
+      other.held_bytes += c.held_bytes;
+      other.held_handles += c.held_handles;
+      has_other = true;
+      return;
+    }
+    setTenantStats(layout.tenants[slot], c);
+  });
+  if (has_other) {
+    ipc::TenantStats &slot = layout.tenants[kNamedSlots];
+    if (layout.tenant_count.load(std::memory_order_relaxed) == kNamedSlots) {
+      slot.id.store(ipc::kOtherTenants, std::memory_order_relaxed);
+      layout.tenant_count.store(ipc::kStatsTenants, std::memory_order_release);
+    }
+    setTenantStats(slot, other);
+  }
+}
+
+// Polls the lanes once, blocking up to `ts` (forever when null). Returns a
+// bit per ready lane. A hung up lane counts as ready so that reading it
+// reports the error.
+uint32_t pollLanes(const int *fds, size_t count, const struct timespec *ts) {
+  struct pollfd pfds[ipc::kMaxLanes];
+  for (size_t k = 0; k < count; ++k) {
+    pfds[k] = {fds[k], POLLIN, 0};
+  }
+  int rc;
+  do {
+    rc = ppoll(pfds, count, ts, nullptr);
+  } while (rc < 0 && errno == EINTR);
+  if (rc < 0) {
+    throw std::runtime_error("ppoll on lanes failed: " +
+                             std::string(strerror(errno)));
+  }
+  uint32_t ready = 0;
+  for (size_t k = 0; rc > 0 && k < count; ++k) {
+    if (pfds[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ready |= 1u << k;
+    }
+  }
+  return ready;
+}
+
+// Waits up to `timeout_ns` (forever when negative) for any of the lanes to
+// become readable and returns a bit per ready lane, 0 on timeout. `probe`
+// checks the lanes without blocking; it is spun on for the receive spin
+// budget before the wait sleeps in ppoll.
+template <typename Probe>
+uint32_t waitLanes(const int *fds, size_t count, int64_t timeout_ns,
+                   Probe probe) {
+  uint32_t ready = probe();
+  if (ready != 0 || timeout_ns == 0) {
+    return ready;
+  }
+  ipc::AdaptiveSpin &spin = receiveSpin();
+  const uint64_t start_ns = ipc::monotonicNs();
+  const uint64_t limit_ns =
+      timeout_ns < 0 ? spin.budgetNs()
+                     : std::min<uint64_t>(spin.budgetNs(), timeout_ns);
+  uint64_t waited_ns = 0;
+  while (ready == 0 && waited_ns < limit_ns) {
+    ipc::cpuRelax();
+    ready = probe();
+    waited_ns = ipc::monotonicNs() - start_ns;
+  }
+  const bool spun = ready != 0;
+  if (ready == 0 && (timeout_ns < 0 || waited_ns < uint64_t(timeout_ns))) {
+    const uint64_t left_ns = timeout_ns - waited_ns;
+    struct timespec ts;
+    ts.tv_sec = left_ns / 1000000000;
+    ts.tv_nsec = left_ns % 1000000000;
+    ready = pollLanes(fds, count, timeout_ns < 0 ? nullptr : &ts);
+  }
+  if (ready != 0) {
+    spin.record(ipc::monotonicNs() - start_ns, spun);
+  }
+  return ready;
+}
+
+// Waits for the reader's lanes. With a doorbell the spin, and the check for
+// more descriptors after each one read, only load the shared counts; without
+// one every probe is a non-blocking ppoll.
+uint32_t waitLanes(const ipc::LaneReader &reader, int64_t timeout_ns) {
+  const std::vector<int> &fds = reader.fds();
+  if (reader.hasDoorbell()) {
+    return waitLanes(fds.data(), fds.size(), timeout_ns,
+                     [&] { return reader.pending(); });
+  }
+  const struct timespec zero = {0, 0};
+  return waitLanes(fds.data(), fds.size(), timeout_ns,
+                   [&] { return pollLanes(fds.data(), fds.size(), &zero); });
+}
+
+// Sleeps until `fd` is readable. Only the producer's pause at the high
+// watermark waits like this; releases take far longer than a spin budget,
+// so it does not spin.
+void waitReadable(int fd) { pollLanes(&fd, 1, nullptr); }
+
+// Parses the comma separated lane fds handed to a worker process.
+std::vector<int> parseLaneFds(const char *arg) {
+  std::vector<int> fds;
+  for (uint64_t fd : ipc::parseUintList(arg)) {
+    fds.push_back(static_cast<int>(fd));
+  }
+  if (fds.empty() || fds.size() > ipc::kMaxLanes) {
+    throw std::runtime_error("Invalid lane list: " + std::string(arg));
+  }
+  return fds;
+}
+
+// Maps the lane doorbell the parent handed over as `fd`, or returns null when
+// it could not create one; the consumer then probes the pipes with ppoll.
+std::unique_ptr<ipc::LaneDoorbell> openDoorbell(int fd) {
+  std::unique_ptr<ipc::LaneDoorbell> doorbell;
+  if (fd >= 0) {
+    doorbell.reset(new ipc::LaneDoorbell(fd));
+    close(fd);
+  }
+  return doorbell;
+}
+
+// Where a tensor hands its mapping back once LibTorch drops it. There is one
+// consumer per process, so a tensor only carries its entry as the deleter
+// context and the deleter is a plain function pointer; a capturing deleter
+// would become a heap allocated std::function in every tensor.
+struct MappingRelease {
+  ipc::MappingTable *mappings = nullptr;
+  ipc::DeferredReclaimer *reclaimer = nullptr;
+};
+
+MappingRelease &mappingRelease() {
+  static MappingRelease release;
+  return release;
+}
+
+// Tensor deleter: drop the mapping reference, evict once idle. Once the
+// reference is gone the entry may be freed at any time, so what the close
+// request needs is read before.
+void releaseMapping(void *context) {
+  ipc::MappingEntry *entry = static_cast<ipc::MappingEntry *>(context);
+  const MappingRelease &release = mappingRelease();
+  const uint8_t kind = entry->kind;
+  const uint64_t hash = entry->hash;
+  if (release.mappings->release(entry)) {
+    release.reclaimer->enqueue({entry, -1, kind, hash});
+  }
+}
+
+// Runs a LibTorch call that builds a tensor. Tensor metadata is heap
+// allocated, so these calls are the one thing the receive loop may allocate
+// for once it is warm.
+template <typename Build> torch::Tensor buildTensor(Build build) {
+  ipc::SteadyStatePause libtorch;
+  return build();
+}
+
+struct ReceivedTensor {
+  int index;
+  uint32_t tenant;
+  uint64_t nbytes;
+  torch::Tensor tensor;
+};
+
+// Collates a batch into one [n, ...] model input. Tensors of equal shape and
+// dtype that sit at a constant stride in memory, such as consecutive
+// allocations of one producer slab, become a zero-copy strided view. Anything
+// else is gathered into a reusable buffer.
+class BatchCollator {
+public:
+  static constexpr size_t kMaxBuffers = 8;
+
+  torch::Tensor collate(const std::vector<ReceivedTensor> &batch) {
+    if (batch.size() == 1) {
+      return batch[0].tensor.unsqueeze(0);
+    }
+    torch::Tensor view = tryView(batch);
+    if (view.defined()) {
+      return view;
+    }
+    scratch_.clear();
+    for (const ReceivedTensor &r : batch) {
+      scratch_.push_back(r.tensor);
+    }
+    std::vector<int64_t> sizes = {static_cast<int64_t>(batch.size())};
+    for (int64_t d : batch[0].tensor.sizes()) {
+      sizes.push_back(d);
+    }
+    torch::Tensor buffer = acquireBuffer(sizes, batch[0].tensor.options());
+    torch::stack_out(buffer, scratch_, 0);
+    scratch_.clear();
+    return buffer;
+  }
+
+private:
+  torch::Tensor tryView(const std::vector<ReceivedTensor> &batch) {
+    const torch::Tensor &first = batch[0].tensor;
+    if (!first.is_contiguous()) {
+      return {};
+    }
+    const int64_t elem = first.element_size();
+    char *base = static_cast<char *>(first.data_ptr());
+    int64_t stride = static_cast<char *>(batch[1].tensor.data_ptr()) - base;
+    if (stride < static_cast<int64_t>(first.nbytes()) || stride % elem != 0) {
+      return {};
+    }
+    for (size_t k = 1; k < batch.size(); ++k) {
+      const torch::Tensor &t = batch[k].tensor;
+      if (!t.is_contiguous() || t.scalar_type() != first.scalar_type() ||
+          t.device() != first.device() || t.sizes() != first.sizes() ||
+          static_cast<char *>(t.data_ptr()) - base !=
+              stride * static_cast<int64_t>(k)) {
+        return {};
+      }
+    }
+    std::vector<int64_t> sizes = {static_cast<int64_t>(batch.size())};
+    std::vector<int64_t> strides = {stride / elem};
+    for (int64_t d = 0; d < first.dim(); ++d) {
+      sizes.push_back(first.size(d));
+      strides.push_back(first.stride(d));
+    }
+    // The view keeps every source tensor, and so every mapping, alive
+    std::vector<torch::Tensor> owners;
+    owners.reserve(batch.size());
+    for (const ReceivedTensor &r : batch) {
+      owners.push_back(r.tensor);
+    }
+    return torch::from_blob(
+        base, sizes, strides, [owners](void *) {}, first.options());
+  }
+
+  torch::Tensor acquireBuffer(const std::vector<int64_t> &sizes,
+                              const torch::TensorOptions &options) {
+    for (torch::Tensor &buffer : buffers_) {
+      // Reuse buffers the previous consumer of the batch has let go of
+      if (buffer.use_count() == 1 && buffer.sizes() == sizes &&
+          buffer.options().dtype() == options.dtype() &&
+          buffer.device() == options.device()) {
+        return buffer;
+      }
+    }
+    torch::Tensor buffer = torch::empty(sizes, options);
+    if (buffers_.size() < kMaxBuffers) {
+      buffers_.push_back(buffer);
+    }
+    return buffer;
+  }
+
+  std::vector<torch::Tensor> buffers_;
+  std::vector<torch::Tensor> scratch_;
+};
+
+// How received tensors are checked. Printing copies every tensor to the host
+// and formats it, which costs far more than the transfer itself; the other
+// modes check contents against the producer's pattern and only report
+// mismatches.
+enum class VerifyMode { kPrint, kFull, kSample, kOff };
+
+// Checks every IPC_VERIFY_EVERY-th received tensor:
+// - full:   compares every element on the tensor's device and copies back
+//           one mismatch count
+// - sample: gathers IPC_VERIFY_SAMPLES elements spread across the tensor,
+//           at an offset that moves with the tensor index
+class TensorVerifier {
+public:
+  TensorVerifier(VerifyMode mode, uint64_t every, uint64_t samples)
+      : mode_(mode), every_(std::max<uint64_t>(every, 1)),
+        samples_(std::max<uint64_t>(samples, 1)) {}
+
+  static bool modeFromName(const std::string &name, VerifyMode &mode) {
+    if (name == "print") {
+      mode = VerifyMode::kPrint;
+    } else if (name == "full") {
+      mode = VerifyMode::kFull;
+    } else if (name == "sample") {
+      mode = VerifyMode::kSample;
+    } else if (name == "off") {
+      mode = VerifyMode::kOff;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  bool prints() const { return mode_ == VerifyMode::kPrint; }
+
+  void check(int index, const torch::Tensor &tensor) {
+    if (mode_ == VerifyMode::kPrint || mode_ == VerifyMode::kOff ||
+        static_cast<uint64_t>(index) % every_ != 0) {
+      return;
+    }
+    const torch::Tensor flat = tensor.flatten();
+    const int64_t numel = flat.numel();
+    const torch::ScalarType dtype = flat.scalar_type();
+    int64_t mismatched;
+    if (mode_ == VerifyMode::kFull ||
+        static_cast<uint64_t>(numel) <= samples_) {
+      const torch::Tensor positions = torch::arange(
+          numel, torch::TensorOptions().dtype(torch::kInt64).device(
+                     flat.device()));
+      mismatched = flat.ne(expectedContents(index, positions, dtype))
+                       .sum()
+                       .item<int64_t>();
+    } else {
+      const int64_t count = static_cast<int64_t>(samples_);
+      const int64_t stride = numel / count;
+      positions_.resize(count);
+      for (int64_t j = 0; j < count; ++j) {
+        positions_[j] = j * stride + index % stride;
+      }
+      const torch::Tensor positions =
+          torch::from_blob(positions_.data(), {count},
+                           torch::TensorOptions().dtype(torch::kInt64));
+      const torch::Tensor sampled =
+          flat.index_select(0, positions.to(flat.device()))
+              .to(torch::kCPU);
+      mismatched = sampled.ne(expectedContents(index, positions, dtype))
+                       .sum()
+                       .item<int64_t>();
+    }
+    ++checked_;
+    if (mismatched > 0) {
+      if (bad_tensors_ == 0) {
+        first_bad_ = index;
+      }
+      ++bad_tensors_;
+      bad_elements_ += static_cast<uint64_t>(mismatched);
+    }
+  }
+
+  uint64_t mismatches() const { return bad_tensors_; }
+
+  std::string summary() const {
+    static const char *kNames[] = {"print", "full", "sample", "off"};
+    std::ostringstream out;
+    out << "verify (" << kNames[static_cast<int>(mode_)] << "): " << checked_
+        << " tensors checked, " << bad_tensors_ << " mismatched";
+    if (bad_tensors_ > 0) {
+      out << " (" << bad_elements_ << " elements, first #" << first_bad_
+          << ")";
+    }
+    out << "\n";
+    return out.str();
+  }
+
+private:
+  VerifyMode mode_;
+  uint64_t every_;
+  uint64_t samples_;
+  std::vector<int64_t> positions_;
+  uint64_t checked_ = 0;
+  uint64_t bad_tensors_ = 0;
+  uint64_t bad_elements_ = 0;
+  int first_bad_ = 0;
+};
+
+// IPC_VERIFY picks how tensors are checked; see TensorVerifier
+TensorVerifier makeVerifier() {
+  VerifyMode mode;
+  const std::string name = envOr("IPC_VERIFY", "print");
+  if (!TensorVerifier::modeFromName(name, mode)) {
+    throw std::runtime_error("Unknown IPC_VERIFY: " + name);
+  }
+  return TensorVerifier(mode, envOr("IPC_VERIFY_EVERY", uint64_t(1)),
+                        envOr("IPC_VERIFY_SAMPLES", uint64_t(64)));
+}
 } // namespace
 
-void producer(int tensor_pipe_write, int producer_done_write,
-              int consumer_done_read) {
+void producer(const std::vector<int> &lane_writes, int producer_done_write,
+               int consumer_done_read, int doorbell_fd) {
   try {
     DEBUG_LOG("Producer starting");
+    const ipc::WorkerPlacement placement = workerPlacement("producer");
+    ipc::applyPlacement(placement);
+    ipc::WorkerStats &stats = workerStats(ipc::StatsRole::kProducer);
+    DEBUG_LOG("Producer placed on " << placement.describe());
     cudaSetDevice(0);
     cudaFree(0);
 
-    using uptr = std::unique_ptr<void, std::function<void(void *)>>;
+    // Capability handshake: send ours, let the consumer pick the transport
+    ipc::CapabilityRecord caps = localCapabilityRecord();
+    ipc::writeExact(lane_writes[0], &caps, sizeof(caps), "capability record");
+    ipc::HandshakeReply reply;
+    ipc::readExact(consumer_done_read, &reply, sizeof(reply),
+                   "handshake reply");
+    ipc::validateCapabilities(reply.caps);
+    ipc::Transport transport = static_cast<ipc::Transport>(reply.transport);
+    if (transport == ipc::Transport::kNone ||
+        !(caps.transports & ipc::transportBit(transport))) {
+      throw std::runtime_error("No mutually supported transport");
+    }
+    DEBUG_LOG("Producer negotiated transport "
+              << ipc::transportName(transport));
+
+    const bool on_device = caps.backends & ipc::kBackendCuda;
+    ipc::GpuCostProfile costs;
+    ipc::HostBackend host(caps.huge_pages && reply.caps.huge_pages);
+    configureCostProfile(costs, host, on_device);
+    // Staging slots are host memory on every backend and pay no simulated
+    // CUDA costs; the copies into them are charged instead
+    ipc::HostBackend staging_host(caps.huge_pages && reply.caps.huge_pages);
+    ipc::HostStagingPool staging(staging_host);
+    ipc::NodePool slot_pool;
+    StagedSlots staged_slots{StagedSlots::allocator_type(slot_pool)};
+    staged_slots.reserve(1024);
+
+    // IPC_TRANSPORT_POLICY=adaptive (default) lets the cost model pick a
+    // delivery path per tensor; fixed always uses the negotiated transport.
+    uint32_t usable = reply.usable_transports & caps.transports;
+    uint32_t paths = envOr("IPC_TRANSPORT_POLICY", "adaptive") == "fixed"
+                         ? ipc::deliveryPathBit(
+                               fixedDeliveryPath(transport, on_device))
+                         : allowedDeliveryPaths(usable, on_device);
+    ipc::TransportCostModel model(paths);
+
+    // Tensors are carved out of shared slabs (IPC_SLAB_BYTES, 2 MiB by
+    // default), so one exported handle covers many tensors. Slabs stay alive
+    // until the consumer has released every mapping of them.
+    ipc::SlabAllocator slabs(
+        [on_device, &host, &costs](size_t nbytes) {
+          if (!on_device) {
+            return host.malloc(nbytes);
+          }
+          void *ptr;
+          uint64_t start_ns = ipc::monotonicNs();
+          cudaError_t err = cudaMalloc(&ptr, nbytes);
+          if (err != cudaSuccess) {
+            throw std::runtime_error("cudaMalloc failed: " +
+                                     std::string(cudaGetErrorString(err)));
+          }
+          costs.record(ipc::GpuCostProfile::kMalloc,
+                       ipc::monotonicNs() - start_ns);
+          return ptr;
+        },
+        [on_device, &host, &costs](void *ptr) {
+          if (on_device) {
+            uint64_t start_ns = ipc::monotonicNs();
+            cudaFree(ptr);
+            costs.record(ipc::GpuCostProfile::kFree,
+                         ipc::monotonicNs() - start_ns);
+          } else {
+            host.free(ptr);
+          }
+        },
+        envOr("IPC_SLAB_BYTES", uint64_t(2) << 20));
 
-    // Store tensors to keep memory allocated
-    std::vector<uptr> allocations;
-    for (int i = 1; i <= 9; i++) {
-      DEBUG_LOG("Producer creating tensor #" + std::to_string(i));
+    // Small tensors take the urgent lanes so they never queue behind bulk
+    // ones; IPC_LANE_THRESHOLDS gives the largest size each lane accepts.
+    const int lanes = static_cast<int>(lane_writes.size());
+    const std::vector<uint64_t> lane_thresholds =
+        ipc::parseUintList(envOr("IPC_LANE_THRESHOLDS", "4096"));
+    // IPC_TENANTS spreads the tensors over that many tenants, standing in for
+    // several producers sharing one consumer.
+    const uint64_t tenants =
+        std::max<uint64_t>(envOr("IPC_TENANTS", uint64_t(1)), 1);
+    // IPC_DEADLINE_US gives every tensor a deadline that long after it is
+    // produced; stale ones are dropped or flagged by the consumer.
+    const uint64_t deadline_ns = envOr("IPC_DEADLINE_US", uint64_t(0)) * 1000;
 
-      // Allocate CUDA memory
-      void *d_ptr;
-      int data[2] = {i, i * 2};
-      cudaError_t err = cudaMalloc(&d_ptr, sizeof(data));
-      if (err != cudaSuccess) {
-        throw std::runtime_error("cudaMalloc failed: " +
-                                 std::string(cudaGetErrorString(err)));
+    // Admission control: IPC_RATE_TENSORS and IPC_RATE_BYTES cap the
+    // sustained rate per second, with bursts of IPC_RATE_BURST_MS worth of
+    // traffic. Production pauses once the consumer maps more than
+    // IPC_HIGH_WATERMARK exported bytes and resumes below IPC_LOW_WATERMARK.
+    const double burst_s = envOr("IPC_RATE_BURST_MS", uint64_t(10)) / 1e3;
+    const double tensor_rate = envOr("IPC_RATE_TENSORS", uint64_t(0));
+    const double byte_rate = envOr("IPC_RATE_BYTES", uint64_t(0));
+    ipc::TokenBucket tensor_bucket(tensor_rate, tensor_rate * burst_s);
+    ipc::TokenBucket byte_bucket(byte_rate, byte_rate * burst_s);
+    const uint64_t high_watermark = envOr("IPC_HIGH_WATERMARK", uint64_t(0));
+    ipc::Watermark watermark(
+        high_watermark, envOr("IPC_LOW_WATERMARK", high_watermark / 2));
+    uint64_t throttled_ns = 0;
+
+    // The tensors to send come from a load generator. IPC_LOAD_SIZE (bytes)
+    // and IPC_LOAD_ARRIVAL (gaps in microseconds) are distributions,
+    // IPC_LOAD_DTYPES a weighted list of element types. The run stops after
+    // IPC_LOAD_COUNT tensors or IPC_LOAD_DURATION_MS, whichever comes first;
+    // with a duration the count defaults to no limit. The defaults send nine
+    // two-element int32 tensors back to back.
+    // IPC_REPLAY replays a recorded trace instead, IPC_REPLAY_SPEED times as
+    // fast as it was recorded.
+    std::function<bool(ipc::LoadItem &)> nextItem;
+    const std::string replay_path = envOr("IPC_REPLAY", "");
+    if (!replay_path.empty()) {
+      auto replay = std::make_shared<ipc::TraceReplay>(
+          replay_path, strtod(envOr("IPC_REPLAY_SPEED", "1").c_str(), nullptr));
+      DEBUG_LOG("Producer replaying " << replay->size() << " tensors from "
+                                      << replay_path);
+      nextItem = [replay](ipc::LoadItem &item) { return replay->next(item); };
+    } else {
+      // A duration alone runs for that long; the default count only applies
+      // when no duration is given
+      const uint64_t load_duration_ms =
+          envOr("IPC_LOAD_DURATION_MS", uint64_t(0));
+      const uint64_t load_count =
+          envOr("IPC_LOAD_COUNT", uint64_t(load_duration_ms > 0 ? 0 : 9));
+      auto load = std::make_shared<ipc::LoadGenerator>(
+          envOr("IPC_LOAD_SIZE", "fixed:8"),
+          envOr("IPC_LOAD_ARRIVAL", "fixed:0"),
+          envOr("IPC_LOAD_DTYPES", "int32"),
+          load_count, load_duration_ms * 1000000,
+          envOr("IPC_LOAD_SEED", uint64_t(1)));
+      nextItem = [load](ipc::LoadItem &item) { return load->next(item); };
+    }
+    // IPC_RECORD captures every descriptor sent into a trace file
+    std::unique_ptr<ipc::TraceWriter> recorder;
+    const std::string record_path = envOr("IPC_RECORD", "");
+    if (!record_path.empty()) {
+      recorder.reset(new ipc::TraceWriter(record_path));
+    }
+    // After the first IPC_ALLOCATION_WARMUP tensors the descriptor path
+    // must not allocate; IPC_CHECK_ALLOCATIONS=1 fails the run if it does.
+    const uint64_t allocation_warmup =
+        envOr("IPC_ALLOCATION_WARMUP", uint64_t(64));
+    const torch::Device device = on_device ? torch::Device(torch::kCUDA, 0)
+                                           : torch::Device(torch::kCPU);
+    const torch::TensorOptions tensor_options =
+        torch::TensorOptions().device(device);
+    std::unique_ptr<ipc::LaneDoorbell> doorbell = openDoorbell(doorbell_fd);
+    ipc::LaneWriter writer(lane_writes, doorbell.get());
+    const bool print_tensors = makeVerifier().prints();
+    // IPC_CHECKSUM=1 attaches a CRC32C to every tensor whose bytes pass
+    // through host memory. It is taken where the bytes first reach the host:
+    // the fill on the host backend, the device-to-host copy on CUDA.
+    const bool checksums = envOr("IPC_CHECKSUM", uint64_t(0)) != 0;
+
+    const uint64_t run_start_ns = ipc::monotonicNs();
+    ipc::LoadItem item;
+    int sent = 0;
+    uint64_t sent_bytes = 0;
+    for (int i = 1; nextItem(item); i++) {
+      DEBUG_LOG("Producer creating tensor #" << i);
+      const uint64_t arrival_ns = run_start_ns + item.arrival_ns;
+      uint64_t now_ns = ipc::monotonicNs();
+      if (arrival_ns > now_ns) {
+        ipc::sleepNs(arrival_ns - now_ns);
       }
-      allocations.push_back(uptr(d_ptr, [](void *ptr) { cudaFree(ptr); }));
+      const uint64_t nbytes = item.nbytes;
+      const int64_t numel = nbytes / ipc::dtypeSize(item.dtype);
+      const torch::ScalarType dtype = torchDtype(item.dtype);
+
+      // Wait for the consumer to release mappings, then for rate tokens
+      uint64_t admit_ns = ipc::monotonicNs();
+      if (watermark.paused(slabs.exportedBytes())) {
+        // Mappings the consumer keeps cached while idle count as exported
+        ipc::TensorDescriptor release_idle{};
+        release_idle.index = ipc::kReleaseIdleIndex;
+        writer.send(release_idle);
+      }
+      while (watermark.paused(slabs.exportedBytes())) {
+        DEBUG_LOG("Producer paused at " << slabs.exportedBytes()
+                                        << " exported bytes");
+        waitReadable(consumer_done_read);
+        drainBackChannel(consumer_done_read, false, model, staging,
+                         staged_slots, slabs, stats);
+      }
+      now_ns = ipc::monotonicNs();
+      uint64_t delay_ns = std::max(tensor_bucket.delayNs(1, now_ns),
+                                   byte_bucket.delayNs(nbytes, now_ns));
+      if (delay_ns > 0) {
+        ipc::sleepNs(delay_ns);
+        now_ns = ipc::monotonicNs();
+      }
+      tensor_bucket.consume(1, now_ns);
+      byte_bucket.consume(nbytes, now_ns);
+      throttled_ns += now_ns - admit_ns;
+      stats.stage(ipc::Stage::kAdmit).record(now_ns - admit_ns);
+
+      // Allocate CUDA or host memory
+      ipc::SlabAllocation alloc = slabs.allocate(nbytes);
+      IPC_PROBE(alloc, i, nbytes, alloc.alloc_id);
+      void *d_ptr = alloc.ptr;
 
       // Create tensor from raw memory
-      std::vector<int64_t> sizes = {2};
       torch::Tensor gpu_tensor = torch::from_blob(
-          d_ptr, sizes,
-          torch::TensorOptions().dtype(torch::kInt32).device(torch::kCUDA, 0));
+          d_ptr, torch::IntArrayRef(&numel, 1), tensor_options.dtype(dtype));
+
+      // Fill tensor with data: element k holds i * (k + 1)
+      torch::Tensor data = expectedContents(
+          i, torch::arange(numel, torch::TensorOptions().dtype(torch::kInt64)),
+          dtype);
+      uint32_t crc = 0;
+      copyIn(d_ptr, data.data_ptr(), nbytes, on_device, costs,
+             checksums && !on_device ? &crc : nullptr);
+      uint32_t *copy_crc = checksums && on_device ? &crc : nullptr;
 
-      // Get IPC handle
-      cudaIpcMemHandle_t handle;
-      err = cudaIpcGetMemHandle(&handle, gpu_tensor.data_ptr());
-      if (err != cudaSuccess) {
-        std::stringstream ss;
-        ss << "cudaIpcGetMemHandle failed: " << cudaGetErrorString(err)
-           << " for tensor at " << gpu_tensor.data_ptr();
-        throw std::runtime_error(ss.str());
+      if (print_tensors) {
+        std::cout << "#" << i << ": Tensor to send: " << gpu_tensor
+                  << std::endl;
       }
 
-      // Fill tensor with data
-      cudaMemcpy(d_ptr, data, sizeof(data), cudaMemcpyHostToDevice);
+      // From here to the send the descriptor path runs allocation free
+      ipc::SteadyStateScope steady(static_cast<uint64_t>(i) >
+                                   allocation_warmup);
+      drainBackChannel(consumer_done_read, false, model, staging, staged_slots,
+                       slabs, stats);
+      ipc::TensorDescriptor desc{};
+      desc.index = i;
+      desc.nbytes = nbytes;
+      desc.dtype = static_cast<uint8_t>(item.dtype);
+      desc.alloc_id = -1;
+      desc.tenant = item.tenant >= 0
+                        ? static_cast<uint32_t>(item.tenant)
+                        : static_cast<uint32_t>((i - 1) % tenants);
+      const uint64_t budget_ns =
+          item.deadline_ns > 0 ? item.deadline_ns : deadline_ns;
+      desc.deadline_ns = budget_ns > 0 ? ipc::monotonicNs() + budget_ns : 0;
+      // A replayed tensor keeps its recorded lane, folded onto the last one
+      // when this run has fewer, and its recorded path when this run allows
+      // it; otherwise the cost model picks the path
+      desc.lane = static_cast<uint8_t>(
+          item.lane >= 0
+              ? std::min(item.lane, lanes - 1)
+              : ipc::laneForSize(desc.nbytes, lane_thresholds, lanes));
+      const bool recorded_path =
+          item.path >= 0 && item.path < ipc::kNumDeliveryPaths &&
+          (model.allowedPaths() & (1u << item.path)) != 0;
+      ipc::DeliveryPath path =
+          recorded_path ? static_cast<ipc::DeliveryPath>(item.path)
+                        : model.choose(desc.nbytes);
+      desc.path = static_cast<uint8_t>(path);
+      uint64_t start_ns = ipc::monotonicNs();
 
-      {
-        std::cout << "#" << i << ": Tensor to send after cudaIpcGetMemHandle: "
-                  << gpu_tensor << std::endl;
+      size_t payload_bytes = 0;
+      switch (path) {
+      case ipc::DeliveryPath::kIpcMapping: {
+        // Every tensor of a slab shares the slab's handle, exported once
+        const uint8_t *cached = slabs.cachedHandle(alloc.alloc_id);
+        if (cached == nullptr) {
+          uint8_t handle_bytes[64];
+          if (on_device) {
+            // Get IPC handle
+            cudaIpcMemHandle_t handle;
+            uint64_t handle_ns = ipc::monotonicNs();
+            cudaError_t err = cudaIpcGetMemHandle(&handle, alloc.base);
+            if (err != cudaSuccess) {
+              std::stringstream ss;
+              ss << "cudaIpcGetMemHandle failed: " << cudaGetErrorString(err)
+                 << " for slab at " << alloc.base;
+              throw std::runtime_error(ss.str());
+            }
+            costs.record(ipc::GpuCostProfile::kGetHandle,
+                         ipc::monotonicNs() - handle_ns);
+            memcpy(handle_bytes, &handle, sizeof(handle));
+          } else {
+            ipc::HostIpcHandle handle = host.getMemHandle(alloc.base);
+            memcpy(handle_bytes, &handle, sizeof(handle));
+          }
+          slabs.setHandle(alloc.alloc_id, handle_bytes);
+          IPC_PROBE(export, i, alloc.slab_size,
+                    ipc::hashHandleBytes(handle_bytes));
+          cached = slabs.cachedHandle(alloc.alloc_id);
+        }
+        desc.transport = static_cast<uint8_t>(
+            on_device ? ipc::Transport::kCudaIpc : ipc::Transport::kHostShm);
+        desc.flags |= checksums && !on_device ? ipc::kDescriptorHasCrc : 0;
+        desc.alloc_id = alloc.alloc_id;
+        desc.offset = alloc.offset;
+        memcpy(desc.handle, cached, sizeof(desc.handle));
+        break;
       }
-
-      // Send tensor index
-      if (write(tensor_pipe_write, &i, sizeof(i)) != sizeof(i)) {
-        throw std::runtime_error("Failed to write tensor index");
+      case ipc::DeliveryPath::kPooledStaging: {
+        void *slot = staging.acquire(desc.nbytes);
+        staged_slots[i] = slot;
+        copyOut(slot, d_ptr, desc.nbytes, on_device, costs, copy_crc);
+        desc.flags |= checksums ? ipc::kDescriptorHasCrc : 0;
+        ipc::HostIpcHandle handle = staging_host.getMemHandle(slot);
+        desc.transport = static_cast<uint8_t>(ipc::Transport::kHostShm);
+        memcpy(desc.handle, &handle, sizeof(handle));
+        break;
       }
-      DEBUG_LOG("Producer sent index for #" + std::to_string(i));
+      case ipc::DeliveryPath::kInlineCopy:
+        payload_bytes = desc.nbytes;
+        copyOut(writer.payload(payload_bytes), d_ptr, desc.nbytes, on_device,
+                costs, copy_crc);
+        desc.flags |= checksums ? ipc::kDescriptorHasCrc : 0;
+        desc.transport = static_cast<uint8_t>(ipc::Transport::kStagedCopy);
+        break;
+      }
+      desc.crc32c = desc.flags & ipc::kDescriptorHasCrc ? crc : 0;
 
-      // Send IPC handle
-      if (write(tensor_pipe_write, &handle, sizeof(handle)) != sizeof(handle)) {
-        throw std::runtime_error("Failed to write IPC handle");
+      // Send descriptor, followed by the payload for inline copies
+      writer.send(desc, payload_bytes);
+      IPC_PROBE(send, i, nbytes, handleFingerprint(desc));
+      const uint64_t send_ns = ipc::monotonicNs() - start_ns;
+      model.record(path, ipc::TransportCostModel::Side::kProducer, desc.nbytes,
+                   send_ns);
+      // Copies no longer reference the source tensor
+      if (path == ipc::DeliveryPath::kIpcMapping) {
+        slabs.markExported(alloc.alloc_id, desc.nbytes);
+      } else {
+        slabs.releaseLocal(alloc.alloc_id);
+      }
+      stats.stage(ipc::Stage::kSend).record(send_ns);
+      ipc::statAdd(stats.tensors, 1);
+      ipc::statAdd(stats.bytes, nbytes);
+      ipc::statSet(stats.in_flight, slabs.liveSlabs() + staging.busySlots());
+      ++sent;
+      sent_bytes += nbytes;
+      if (recorder) {
+        ipc::TraceRecord record{};
+        record.send_ns = start_ns - run_start_ns;
+        record.nbytes = nbytes;
+        record.deadline_us = static_cast<uint32_t>(budget_ns / 1000);
+        record.tenant = desc.tenant;
+        record.index = desc.index;
+        record.dtype = desc.dtype;
+        record.lane = desc.lane;
+        record.path = desc.path;
+        recorder->append(record);
+      }
+      DEBUG_LOG("Producer sent #" << i << " via "
+                                  << ipc::deliveryPathName(path) << " on lane "
+                                  << int(desc.lane));
+      if (desc.transport == static_cast<uint8_t>(ipc::Transport::kCudaIpc)) {
+        DEBUG_LOG("Producer sent IPC handle "
+                  << cudaIpcHandleToString(
+                         *reinterpret_cast<cudaIpcMemHandle_t *>(desc.handle))
+                         .text
+                  << " for # " << i);
       }
-      DEBUG_LOG("Producer sent IPC handle " + cudaIpcHandleToString(handle) +
-                " for # " + std::to_string(i));
     }
 
+    // Tell the consumer how many tensors to expect
+    ipc::TensorDescriptor end{};
+    end.index = ipc::kEndOfStreamIndex;
+    end.nbytes = sent;
+    writer.send(end);
     DEBUG_LOG("Producer finished sending tensors");
     char done_byte = 'D';
     if (write(producer_done_write, &done_byte, 1) != 1) {
@@ -140,11 +1261,22 @@ void producer(int tensor_pipe_write, int producer_done_write,
     cudaDeviceSynchronize();
 
     DEBUG_LOG("Producer waiting for consumer done");
-    char ack_byte;
-    if (read(consumer_done_read, &ack_byte, 1) != 1) {
-      throw std::runtime_error("Failed to receive consumer done signal");
-    }
+    drainBackChannel(consumer_done_read, true, model, staging, staged_slots,
+                     slabs, stats);
     DEBUG_LOG("Producer received consumer done");
+    std::cout << model.summary();
+    if (recorder) {
+      std::cout << "recorded " << recorder->records() << " descriptors to "
+                << record_path << std::endl;
+    }
+    std::cout << "load: " << sent << " tensors, " << sent_bytes << " bytes in "
+              << (ipc::monotonicNs() - run_start_ns) / 1000000 << " ms"
+              << std::endl;
+    std::cout << "admission: " << throttled_ns / 1000 << " us throttled, "
+              << watermark.trips() << " watermark pauses" << std::endl;
+    checkSteadyStateAllocations("producer");
+
+    saveCapturedCosts(costs);
 
     std::cout << "Producer exits" << std::endl;
   } catch (const std::exception &e) {
@@ -153,68 +1285,581 @@ void producer(int tensor_pipe_write, int producer_done_write,
   }
 }
 
-void consumer(int tensor_pipe_read, int producer_done_read,
-              int consumer_done_write) {
+void consumer(const std::vector<int> &lane_reads, int producer_done_read,
+              int consumer_done_write, int doorbell_fd) {
   try {
     DEBUG_LOG("Consumer starting");
+    const ipc::WorkerPlacement placement = workerPlacement("consumer");
+    ipc::applyPlacement(placement);
+    ipc::WorkerStats &stats = workerStats(ipc::StatsRole::kConsumer);
+    DEBUG_LOG("Consumer placed on " << placement.describe());
     cudaSetDevice(0);
     cudaFree(0);
 
-    DEBUG_LOG("Consumer waiting for producer done signal");
-    char done_byte;
-    if (read(producer_done_read, &done_byte, 1) != 1) {
-      throw std::runtime_error("Failed to receive producer done signal");
+    // Capability handshake: validate the producer and pick the transport
+    ipc::CapabilityRecord remote;
+    ipc::readExact(lane_reads[0], &remote, sizeof(remote), "capability record");
+    ipc::validateCapabilities(remote);
+    ipc::HandshakeReply reply{};
+    reply.caps = localCapabilityRecord();
+    ipc::NegotiationContext ctx{};
+    ctx.peer_access = (reply.caps.backends & ipc::kBackendCuda) &&
+                      (remote.backends & ipc::kBackendCuda) &&
+                      canAccessDevice(remote.device_uuid);
+    ipc::Transport transport =
+        ipc::negotiateTransport(reply.caps, remote, ctx);
+    reply.transport = static_cast<uint8_t>(transport);
+    reply.peer_access = ctx.peer_access ? 1 : 0;
+    reply.usable_transports = ipc::usableTransports(reply.caps, remote, ctx);
+    ipc::writeExact(consumer_done_write, &reply, sizeof(reply),
+                    "handshake reply");
+    if (transport == ipc::Transport::kNone) {
+      throw std::runtime_error("No mutually supported transport");
     }
-    DEBUG_LOG("Consumer received producer done signal");
+    DEBUG_LOG("Consumer negotiated transport "
+              << ipc::transportName(transport));
 
-    for (int i = 1; i <= 9; i++) {
-      DEBUG_LOG("Consumer processing tensor #" + std::to_string(i));
+    const bool on_device = reply.caps.backends & ipc::kBackendCuda;
+    const torch::Device device = on_device ? torch::Device(torch::kCUDA, 0)
+                                           : torch::Device(torch::kCPU);
+    ipc::GpuCostProfile costs;
+    ipc::HostBackend host(reply.caps.huge_pages && remote.huge_pages);
+    configureCostProfile(costs, host, on_device);
+    // Staging slots are mapped without simulated CUDA costs, like on the
+    // producer
+    ipc::HostBackend staging_host(reply.caps.huge_pages && remote.huge_pages);
 
-      // Read tensor index
-      int idx;
-      ssize_t n_read = read(tensor_pipe_read, &idx, sizeof(idx));
-      if (n_read != sizeof(idx)) {
-        throw std::runtime_error("Failed to read tensor index");
+    // Opened mappings, shared by handle and looked up without locks. Up to
+    // IPC_MAPPING_CACHE idle mappings stay open for the next tensor of the
+    // same allocation; evicted ones are unmapped on the reclaimer thread once
+    // their epoch grace period has elapsed.
+    ipc::EpochManager epochs;
+    // Only touched on the reclaimer thread
+    std::vector<ipc::ReleaseRecord> unmapped;
+    const uint64_t mapping_cache = envOr("IPC_MAPPING_CACHE", uint64_t(16));
+    const uint64_t batch_max = envOr("IPC_BATCH_MAX", uint64_t(1));
+    // At most that many idle mappings, as many pinned by prefetch (capped at
+    // the cache below) and a full batch of tensors holding theirs are open
+    // at once; the table gets about a bucket per open mapping.
+    const size_t mapping_buckets =
+        ipc::mappingTableBuckets(2 * mapping_cache + batch_max);
+    ipc::MappingTable mappings(
+        epochs,
+        [&host, &staging_host, &costs, &unmapped](ipc::MappingEntry &entry) {
+          if (entry.kind == static_cast<uint8_t>(ipc::Transport::kCudaIpc)) {
+            uint64_t start_ns = ipc::monotonicNs();
+            cudaIpcCloseMemHandle(entry.ptr);
+            costs.record(ipc::GpuCostProfile::kCloseHandle,
+                         ipc::monotonicNs() - start_ns);
+          } else if (!staging_host.closeMemHandle(entry.ptr)) {
+            host.closeMemHandle(entry.ptr);
+          }
+          IPC_PROBE(close, entry.release_id, entry.size, entry.hash);
+          if (entry.release_id >= 0) {
+            unmapped.push_back(
+                {entry.release_id, entry.uses.load(std::memory_order_relaxed)});
+          }
+        },
+        mapping_cache, mapping_buckets);
+
+    // Idle mappings are cached and evicted off the hot path, and released to
+    // the producer in batches. A request without an entry evicts every idle
+    // mapping. Each release batch is a single atomic pipe write, so it never
+    // interleaves with the feedback written by this thread.
+    ipc::DeferredReclaimer reclaimer(
+        [&mappings](const ipc::CloseRequest &request) {
+          if (request.ptr == nullptr) {
+            mappings.trimIdle(0);
+          } else {
+            mappings.retainIdle(static_cast<ipc::MappingEntry *>(request.ptr),
+                                request.tag);
+          }
+        },
+        [consumer_done_write](const ipc::ReleaseRecord *records,
+                              size_t count) {
+          ipc::writeReleaseBatch(consumer_done_write, records, count);
+        },
+        [on_device] {
+          if (on_device) {
+            cudaSetDevice(0);
+          }
+        },
+        [&epochs, &unmapped](std::vector<ipc::ReleaseRecord> &released) {
+          epochs.reclaim();
+          released.insert(released.end(), unmapped.begin(), unmapped.end());
+          unmapped.clear();
+          return epochs.pending() > 0;
+        });
+
+    mappingRelease() = {&mappings, &reclaimer};
+
+    // Descriptors with a CRC32C are checked as their bytes are read from
+    // host memory; a mismatch is reported and fails the run at the end.
+    uint64_t crc_checked = 0;
+    uint64_t crc_failed = 0;
+    auto checkCrc = [&](const ipc::TensorDescriptor &desc, uint32_t crc) {
+      ++crc_checked;
+      if (crc != desc.crc32c) {
+        ++crc_failed;
+        ipc::statAdd(stats.integrity_failures, 1);
+        std::cout << "#" << desc.index << ": CRC32C mismatch, expected "
+                  << std::hex << desc.crc32c << " got " << crc << std::dec
+                  << std::endl;
       }
-      DEBUG_LOG("Consumer received index for #" + std::to_string(idx));
+    };
 
-      // Read IPC handle
-      cudaIpcMemHandle_t handle;
-      n_read = read(tensor_pipe_read, &handle, sizeof(handle));
-      if (n_read != sizeof(handle)) {
-        throw std::runtime_error("Failed to read IPC handle");
+    // Opens the mapping of a kCudaIpc or kHostShm descriptor into a new
+    // mapping table entry
+    auto openMapping = [&](const ipc::TensorDescriptor &desc,
+                           ipc::MappingEntry &e) {
+      if (desc.transport == static_cast<uint8_t>(ipc::Transport::kCudaIpc)) {
+        cudaIpcMemHandle_t handle;
+        memcpy(&handle, desc.handle, sizeof(handle));
+        void *d_ptr;
+        uint64_t open_ns = ipc::monotonicNs();
+        cudaError_t err = cudaIpcOpenMemHandle(&d_ptr, handle,
+                                               cudaIpcMemLazyEnablePeerAccess);
+        if (err != cudaSuccess) {
+          std::stringstream ss;
+          ss << "cudaIpcOpenMemHandle failed: " << cudaGetErrorString(err);
+          throw std::runtime_error(ss.str());
+        }
+        costs.record(ipc::GpuCostProfile::kOpenHandle,
+                     ipc::monotonicNs() - open_ns);
+        e.ptr = d_ptr;
+        e.size = desc.offset + desc.nbytes;
+        e.kind = static_cast<uint8_t>(ipc::Transport::kCudaIpc);
+        e.release_id = desc.alloc_id;
+      } else {
+        ipc::HostIpcHandle handle;
+        memcpy(&handle, desc.handle, sizeof(handle));
+        const bool staged = static_cast<ipc::DeliveryPath>(desc.path) ==
+                            ipc::DeliveryPath::kPooledStaging;
+        e.ptr = (staged ? staging_host : host).openMemHandle(handle);
+        e.size = handle.size;
+        e.kind = static_cast<uint8_t>(ipc::Transport::kHostShm);
+        // Staging slots are released through the cost feedback instead
+        e.release_id = staged ? -1 : desc.alloc_id;
       }
+      IPC_PROBE(open, desc.index, e.size, handleFingerprint(desc));
+    };
+
+    // With IPC_PREFETCH_DEPTH > 0, the mappings of up to that many queued
+    // descriptors are opened on a background thread before the loop below
+    // gets to them. Prefetched mappings are pinned ahead of demand, so the
+    // lookahead is kept within the mapping cache; a deeper one would hold
+    // more mappings open than the producer expects the consumer to keep.
+    uint64_t prefetch_depth = envOr("IPC_PREFETCH_DEPTH", uint64_t(0));
+    if (prefetch_depth > mapping_cache) {
+      fprintf(stderr,
+              "warning: IPC_PREFETCH_DEPTH %llu exceeds IPC_MAPPING_CACHE "
+              "%llu; prefetching %llu ahead\n",
+              static_cast<unsigned long long>(prefetch_depth),
+              static_cast<unsigned long long>(mapping_cache),
+              static_cast<unsigned long long>(mapping_cache));
+      prefetch_depth = mapping_cache;
+    }
+    std::unique_ptr<ipc::MappingPrefetcher> prefetcher;
+    if (prefetch_depth > 0) {
+      prefetcher = std::make_unique<ipc::MappingPrefetcher>(
+          mappings, prefetch_depth, openMapping,
+          [&reclaimer](ipc::MappingEntry *entry, uint8_t kind,
+                       uint64_t hash) {
+            reclaimer.enqueue({entry, -1, kind, hash});
+          },
+          [on_device] {
+            if (on_device) {
+              cudaSetDevice(0);
+            }
+          });
+    }
 
-      DEBUG_LOG("Received handle: " + cudaIpcHandleToString(handle));
+    // Maps or copies the tensor a descriptor refers to
+    auto materialize = [&](const ipc::PendingDescriptor &pending,
+                           bool &cache_hit) -> torch::Tensor {
+      const ipc::TensorDescriptor &desc = pending.desc;
+      const bool has_crc = desc.flags & ipc::kDescriptorHasCrc;
+      const auto dtype = static_cast<ipc::DType>(desc.dtype);
+      const int64_t numel = desc.nbytes / ipc::dtypeSize(dtype);
+      const torch::TensorOptions options =
+          torch::TensorOptions().dtype(torchDtype(dtype));
+      const auto path = static_cast<ipc::DeliveryPath>(desc.path);
+      torch::Tensor tensor;
+      switch (static_cast<ipc::Transport>(desc.transport)) {
+      case ipc::Transport::kCudaIpc: {
+        cudaIpcMemHandle_t handle;
+        memcpy(&handle, desc.handle, sizeof(handle));
+        DEBUG_LOG("Received handle: " << cudaIpcHandleToString(handle).text);
 
-      // Open shared memory handle
-      void *d_ptr;
-      cudaError_t err =
-          cudaIpcOpenMemHandle(&d_ptr, handle, cudaIpcMemLazyEnablePeerAccess);
-      if (err != cudaSuccess) {
-        std::stringstream ss;
-        ss << "cudaIpcOpenMemHandle failed: " << cudaGetErrorString(err);
-        throw std::runtime_error(ss.str());
+        // Open shared memory handle, or reuse a live mapping of it
+        ipc::MappingEntry *entry = mappings.acquireOrOpen(
+            desc.handle,
+            [&](ipc::MappingEntry &e) { openMapping(desc, e); }, cache_hit);
+        DEBUG_LOG("Consumer " << (cache_hit ? "reused" : "opened")
+                              << " IPC handle of allocation " << desc.alloc_id
+                              << " at " << entry->ptr << " + " << desc.offset);
+
+        // Create tensor from shared memory
+        tensor = buildTensor([&] {
+          return at::for_blob(static_cast<char *>(entry->ptr) + desc.offset,
+                              {numel})
+              .context(entry, releaseMapping)
+              .options(options.device(torch::kCUDA))
+              .make_tensor();
+        });
+        break;
+      }
+      case ipc::Transport::kHostShm: {
+        ipc::HostIpcHandle handle;
+        memcpy(&handle, desc.handle, sizeof(handle));
+        ipc::MappingEntry *entry = mappings.acquireOrOpen(
+            desc.handle,
+            [&](ipc::MappingEntry &e) { openMapping(desc, e); }, cache_hit);
+        DEBUG_LOG("Consumer " << (cache_hit ? "reused" : "opened")
+                              << " host segment " << handle.name << " at "
+                              << entry->ptr << " + " << desc.offset);
+        const char *src = static_cast<char *>(entry->ptr) + desc.offset;
+        tensor = buildTensor([&] {
+          return at::for_blob(const_cast<char *>(src), {numel})
+              .context(entry, releaseMapping)
+              .options(options.device(torch::kCPU))
+              .make_tensor();
+        });
+        // Staging slots are recycled by the producer, so copy out of them;
+        // a host copy checks the CRC as it goes and is charged as the host
+        // to device copy it stands in for
+        if (!on_device && path == ipc::DeliveryPath::kPooledStaging &&
+            has_crc) {
+          torch::Tensor copy =
+              buildTensor([&] { return torch::empty({numel}, options); });
+          checkCrc(desc, ipc::crc32cCopy(copy.data_ptr(), src, desc.nbytes));
+          costs.inject(ipc::GpuCostProfile::kCopyH2D, desc.nbytes);
+          tensor = copy;
+          break;
+        }
+        if (has_crc) {
+          checkCrc(desc, ipc::crc32c(src, desc.nbytes));
+        }
+        if (on_device) {
+          tensor = buildTensor([&] { return tensor.to(device); });
+        } else if (path == ipc::DeliveryPath::kPooledStaging) {
+          tensor = buildTensor([&] { return tensor.clone(); });
+          costs.inject(ipc::GpuCostProfile::kCopyH2D, desc.nbytes);
+        }
+        break;
       }
-      DEBUG_LOG("Consumer opened IPC handle at " << d_ptr);
+      case ipc::Transport::kStagedCopy: {
+        tensor = buildTensor(
+            [&] { return torch::empty({numel}, options.device(device)); });
+        uint32_t crc = 0;
+        copyIn(tensor.data_ptr(), pending.payload.data(),
+               pending.payload.size(), on_device, costs,
+               has_crc ? &crc : nullptr);
+        if (has_crc) {
+          checkCrc(desc, crc);
+        }
+        break;
+      }
+      default:
+        throw std::runtime_error("Unsupported transport in descriptor #" +
+                                 std::to_string(desc.index));
+      }
+
+      return tensor;
+    };
+
+    // Lanes with data are drained in strict priority order, or with
+    // IPC_LANE_POLICY=weighted in proportion to IPC_LANE_WEIGHTS.
+    ipc::LaneScheduler lane_scheduler(
+        envOr("IPC_LANE_POLICY", "strict") == "weighted"
+            ? ipc::LanePolicy::kWeighted
+            : ipc::LanePolicy::kStrict,
+        ipc::parseUintList(envOr("IPC_LANE_WEIGHTS", "")),
+        static_cast<int>(lane_reads.size()));
+
+    // Read descriptors wait in a ready queue per lane. The lane policy above
+    // picks the lane to serve next, and within it they are processed in the
+    // order IPC_SCHED picks: arrival (fifo), deficit round robin across
+    // tenants with IPC_DRR_QUANTUM bytes per turn (drr) or earliest deadline
+    // first (edf). IPC_TENANT_MAX_BYTES and IPC_TENANT_MAX_HANDLES bound how
+    // much each tenant may hold on the consumer at once.
+    ipc::SchedulePolicy policy;
+    std::string policy_name = envOr("IPC_SCHED", "drr");
+    if (!ipc::schedulePolicyFromName(policy_name, policy)) {
+      throw std::runtime_error("Unknown IPC_SCHED: " + policy_name);
+    }
+    ipc::TenantQuota quota;
+    quota.max_bytes = envOr("IPC_TENANT_MAX_BYTES", uint64_t(0));
+    quota.max_handles = envOr("IPC_TENANT_MAX_HANDLES", uint64_t(0));
+    ipc::TenantScheduler<ipc::PendingDescriptor> scheduler(
+        policy, envOr("IPC_DRR_QUANTUM", uint64_t(64) << 10), quota,
+        lane_scheduler);
+    // Per-tenant counters go to the stats segment at most once per
+    // kTenantStatsIntervalNs, and once more when the stream is done
+    constexpr uint64_t kTenantStatsIntervalNs = 1000000;
+    ipc::StatsLayout &stats_layout = statsLayout();
+    uint64_t tenant_stats_ns = 0;
+
+    // IPC_DEADLINE_POLICY says what happens to a descriptor whose deadline
+    // has passed by the time it is scheduled: drop it unprocessed, flag it,
+    // or process it silently.
+    const std::string expiry = envOr("IPC_DEADLINE_POLICY", "flag");
+    if (expiry != "drop" && expiry != "flag" && expiry != "process") {
+      throw std::runtime_error("Unknown IPC_DEADLINE_POLICY: " + expiry);
+    }
+
+    // IPC_BATCH_MAX tensors, or whatever arrived within IPC_BATCH_DELAY_US
+    // of the first one, form one model input.
+    ipc::DynamicBatcher<ReceivedTensor> batcher(
+        batch_max, envOr("IPC_BATCH_DELAY_US", uint64_t(1000)) * 1000);
+    BatchCollator collator;
+    TensorVerifier verifier = makeVerifier();
+    std::vector<ReceivedTensor> batch;
+    auto emitBatch = [&] {
+      batcher.take(batch);
+      {
+        // Collating, checking and printing build LibTorch tensors
+        ipc::SteadyStatePause libtorch;
+        if (!verifier.prints()) {
+          // The model input is still built so timings match a real consumer
+          collator.collate(batch);
+          const uint64_t mismatches = verifier.mismatches();
+          for (const ReceivedTensor &r : batch) {
+            verifier.check(r.index, r.tensor);
+          }
+          ipc::statAdd(stats.integrity_failures,
+                       verifier.mismatches() - mismatches);
+        } else if (batch.size() == 1) {
+          std::cout << "#" << batch[0].index
+                    << ": Tensor received: " << batch[0].tensor << std::endl;
+        } else {
+          torch::Tensor input = collator.collate(batch);
+          std::cout << "#" << batch.front().index << "-#"
+                    << batch.back().index << ": Batch received: " << input
+                    << std::endl;
+        }
+      }
+      // Drop the references so idle mappings can be reclaimed
+      for (const ReceivedTensor &r : batch) {
+        scheduler.release(r.tenant, r.nbytes);
+      }
+      batch.clear();
+    };
+
+    // The number of tensors is known once the producer's end of stream
+    // marker has been read
+    int64_t expected = -1;
+    int64_t received = 0;
+    auto streamDone = [&] { return expected >= 0 && received >= expected; };
+    // Past the first IPC_ALLOCATION_WARMUP descriptors, reading and
+    // scheduling them must not allocate. The reader hands inline payload
+    // buffers back out once their tensor is built.
+    const int64_t allocation_warmup =
+        envOr("IPC_ALLOCATION_WARMUP", uint64_t(64));
+    std::unique_ptr<ipc::LaneDoorbell> doorbell = openDoorbell(doorbell_fd);
+    ipc::LaneReader reader(lane_reads, doorbell.get());
+    auto readDescriptor = [&](int lane) {
+      ipc::SteadyStateScope steady(received >= allocation_warmup);
+      ipc::PendingDescriptor pending;
+      reader.read(lane, pending);
+      if (pending.desc.index == ipc::kEndOfStreamIndex) {
+        expected = static_cast<int64_t>(pending.desc.nbytes);
+        DEBUG_LOG("Consumer expects " << expected << " tensors");
+        return;
+      }
+      if (pending.desc.index == ipc::kReleaseIdleIndex) {
+        DEBUG_LOG("Consumer releasing idle mappings");
+        reclaimer.enqueue({nullptr, -1, 0, 0});
+        return;
+      }
+      ++received;
+      IPC_PROBE(receive, pending.desc.index, pending.desc.nbytes,
+                handleFingerprint(pending.desc));
+      DEBUG_LOG("Consumer received descriptor for #"
+                << pending.desc.index << " from lane " << lane);
+      const uint32_t tenant = pending.desc.tenant;
+      const uint64_t nbytes = pending.desc.nbytes;
+      const uint64_t deadline_ns = pending.desc.deadline_ns;
+      scheduler.push(tenant, lane, nbytes, deadline_ns, std::move(pending));
+      ipc::statSet(stats.queue_depth, scheduler.size());
+    };
+    // Reads every descriptor the lanes hold, waiting up to `timeout_ns` for
+    // the first one. Returns false on timeout.
+    auto drainLanes = [&](int64_t timeout_ns) {
+      uint32_t ready = !streamDone() ? waitLanes(reader, timeout_ns) : 0;
+      const bool any = ready != 0;
+      while (ready != 0) {
+        readDescriptor(lane_scheduler.pick(ready));
+        ready = !streamDone() ? waitLanes(reader, 0) : 0;
+      }
+      return any;
+    };
+
+    // Hands the prefetcher the next mappable descriptors in the order the
+    // scheduler will pop them. The buffer is reused, so this never
+    // allocates once warm.
+    std::vector<ipc::TensorDescriptor> upcoming;
+    upcoming.reserve(prefetch_depth);
+    auto planPrefetch = [&] {
+      if (!prefetcher) {
+        return;
+      }
+      upcoming.clear();
+      scheduler.peek([&](const ipc::PendingDescriptor &next) {
+        if (next.desc.transport !=
+            static_cast<uint8_t>(ipc::Transport::kStagedCopy)) {
+          upcoming.push_back(next.desc);
+        }
+        return upcoming.size() < prefetch_depth;
+      });
+      prefetcher->plan(upcoming.data(), upcoming.size());
+    };
 
-      // Create tensor with custom deleter
-      auto deleter = [](void *ptr) { cudaIpcCloseMemHandle(ptr); };
+    // Descriptors are processed as they arrive; the producer's done signal
+    // is collected once all of them have been handled.
+    for (;;) {
+      drainLanes(0);
+      ipc::PendingDescriptor pending;
+      uint32_t tenant = 0;
+      bool runnable;
+      while (!(runnable = scheduler.pop(pending, tenant)) &&
+             !(streamDone() && scheduler.empty())) {
+        // Nothing runnable: wait for more descriptors. A partial batch is
+        // emitted when its deadline passes first, which also hands the
+        // quota of its tensors back.
+        if (!drainLanes(batcher.timeoutNs(ipc::monotonicNs()))) {
+          if (batcher.empty()) {
+            throw std::runtime_error("Tenant scheduler stalled");
+          }
+          emitBatch();
+        } else {
+          planPrefetch();
+        }
+      }
+      if (!runnable) {
+        break;
+      }
+      planPrefetch();
+      // Once the consumer is warm nothing in this iteration may allocate but
+      // the LibTorch calls in buildTensor() and emitBatch()
+      ipc::SteadyStateScope steady(received > allocation_warmup);
+      const ipc::TensorDescriptor &desc = pending.desc;
+      int idx = desc.index;
+      DEBUG_LOG("Consumer processing tensor #" << idx << " of tenant "
+                                               << tenant);
 
-      // Create tensor from shared memory
-      torch::Tensor tensor = torch::from_blob(
-          d_ptr, {2}, deleter,
-          torch::TensorOptions().dtype(torch::kInt32).device(torch::kCUDA));
+      const uint64_t now_ns = ipc::monotonicNs();
+      stats.stage(ipc::Stage::kQueue).record(now_ns - pending.read_ns);
+      ipc::statSet(stats.queue_depth, scheduler.size());
+      if (now_ns - tenant_stats_ns >= kTenantStatsIntervalNs) {
+        publishTenantStats(scheduler, stats_layout);
+        tenant_stats_ns = now_ns;
+      }
+      if (desc.deadline_ns != 0 && now_ns > desc.deadline_ns) {
+        scheduler.recordExpired(tenant);
+        if (expiry == "drop") {
+          // Hand everything the descriptor pinned back without mapping it
+          DEBUG_LOG("Consumer dropped expired tensor #" << idx);
+          scheduler.release(tenant, desc.nbytes);
+          // A prefetched mapping carries the use to its own release, which
+          // must not reach the producer before the mapping is closed
+          const bool carried =
+              prefetcher && prefetcher->consumed(idx, /*count_use=*/true);
+          if (!carried && desc.alloc_id >= 0) {
+            ipc::ReleaseRecord record = {desc.alloc_id, 1};
+            ipc::writeReleaseBatch(consumer_done_write, &record, 1);
+          }
+          ipc::BackMessage dropped{};
+          dropped.type = static_cast<uint8_t>(ipc::BackMessageType::kDropped);
+          dropped.index = idx;
+          ipc::writeExact(consumer_done_write, &dropped, sizeof(dropped),
+                          "drop notice");
+          reader.recycle(pending.payload);
+          ipc::statAdd(stats.dropped, 1);
+          if (batcher.due(ipc::monotonicNs())) {
+            emitBatch();
+          }
+          continue;
+        }
+        if (expiry == "flag") {
+          std::cout << "#" << idx << ": expired "
+                    << (now_ns - desc.deadline_ns) / 1000 << " us ago"
+                    << std::endl;
+        }
+      }
+
+      uint64_t start_ns = ipc::monotonicNs();
+      bool cache_hit = false;
+      torch::Tensor tensor = materialize(pending, cache_hit);
+      IPC_PROBE(wrap, idx, desc.nbytes, handleFingerprint(desc));
+      reader.recycle(pending.payload);
+      if (prefetcher) {
+        prefetcher->consumed(idx);
+      }
+
+      ipc::BackMessage feedback{};
+      feedback.type = static_cast<uint8_t>(ipc::BackMessageType::kCostFeedback);
+      feedback.path = desc.path;
+      feedback.cache_hit = cache_hit ? 1 : 0;
+      feedback.index = idx;
+      feedback.nbytes = desc.nbytes;
+      feedback.consumer_ns = ipc::monotonicNs() - start_ns;
+      ipc::writeExact(consumer_done_write, &feedback, sizeof(feedback),
+                      "cost feedback");
+      stats.stage(ipc::Stage::kMaterialize).record(feedback.consumer_ns);
+      ipc::statAdd(stats.tensors, 1);
+      ipc::statAdd(stats.bytes, desc.nbytes);
+      if (desc.transport != static_cast<uint8_t>(ipc::Transport::kStagedCopy)) {
+        ipc::statAdd(cache_hit ? stats.cache_hits : stats.cache_misses, 1);
+      }
+      ipc::statSet(stats.open_mappings, mappings.size());
       DEBUG_LOG("Consumer created tensor from blob");
-      std::cout << "#" << idx << ": Tensor received: " << tensor << std::endl;
+      // The batch's deadline counts from when its oldest tensor came off its
+      // lane, and is checked on every add, so a stream that never lets the
+      // consumer go idle still emits partial batches on time
+      if (batcher.add({idx, tenant, desc.nbytes, tensor}, pending.read_ns,
+                      ipc::monotonicNs())) {
+        emitBatch();
+      }
+    }
+    if (!batcher.empty()) {
+      emitBatch();
     }
+    publishTenantStats(scheduler, stats_layout);
 
-    // Signal consumer is done
-    char ack_byte = 'A';
-    if (write(consumer_done_write, &ack_byte, 1) != 1) {
-      throw std::runtime_error("Failed to signal consumer done");
+    DEBUG_LOG("Consumer waiting for producer done signal");
+    char done_byte;
+    if (read(producer_done_read, &done_byte, 1) != 1) {
+      throw std::runtime_error("Failed to receive producer done signal");
     }
+    DEBUG_LOG("Consumer received producer done signal");
+
+    // Every tensor is gone by now; make sure their closes reached the producer
+    std::string prefetch_summary = prefetcher ? prefetcher->summary() : "";
+    prefetcher.reset();
+    reclaimer.enqueue({nullptr, -1, 0, 0});
+    reclaimer.flush();
+
+    // Signal consumer is done
+    ipc::BackMessage done{};
+    done.type = static_cast<uint8_t>(ipc::BackMessageType::kConsumerDone);
+    ipc::writeExact(consumer_done_write, &done, sizeof(done), "done signal");
     DEBUG_LOG("Consumer sent done signal");
+    std::cout << scheduler.summary();
+    std::cout << receiveSpin().summary();
+    std::cout << prefetch_summary;
+    checkSteadyStateAllocations("consumer");
+    std::cout << verifier.summary();
+    if (crc_checked > 0) {
+      std::cout << "integrity: " << crc_checked << " CRC32C checked, "
+                << crc_failed << " failed (" << ipc::crc32cImplementation()
+                << ")" << std::endl;
+    }
+    if (verifier.mismatches() > 0 || crc_failed > 0) {
+      throw std::runtime_error("Received tensors did not match");
+    }
+
+    saveCapturedCosts(costs);
 
     std::cout << "Consumer exits" << std::endl;
   } catch (const std::exception &e) {
@@ -225,31 +1870,83 @@ void consumer(int tensor_pipe_read, int producer_done_read,
 
 int main(int argc, char *argv[]) {
   // If called with arguments, run as worker process
-  if (argc == 5) {
+  if (argc == 6) {
     DEBUG_LOG("Child process started with role: " + std::string(argv[1]));
 
-    int tensor_pipe = atoi(argv[2]);
+    std::vector<int> lanes = parseLaneFds(argv[2]);
     int done_pipe1 = atoi(argv[3]);
     int done_pipe2 = atoi(argv[4]);
+    int doorbell_fd = atoi(argv[5]);
 
     if (strcmp(argv[1], "producer") == 0) {
-      producer(tensor_pipe, done_pipe1, done_pipe2);
+      producer(lanes, done_pipe1, done_pipe2, doorbell_fd);
     } else if (strcmp(argv[1], "consumer") == 0) {
-      consumer(tensor_pipe, done_pipe1, done_pipe2);
+      consumer(lanes, done_pipe1, done_pipe2, doorbell_fd);
     }
     return 0;
   }
 
   DEBUG_LOG("Parent process starting");
 
-  // Create communication pipes
-  int tensor_pipe[2];
+  // Both children append their measurements to a fresh capture file
+  const std::string capture = envOr("IPC_PROFILE_CAPTURE", "");
+  if (!capture.empty()) {
+    FILE *file = fopen(capture.c_str(), "w");
+    if (file == nullptr) {
+      perror("IPC_PROFILE_CAPTURE");
+      return 1;
+    }
+    fputs("# op latency_ns [GB/s], captured by the CUDA IPC sample\n", file);
+    fclose(file);
+  }
+
+  // Live statistics segment the workers publish into, named in
+  // IPC_STATS_NAME for them and for ipc-top. Monitoring must never stop the
+  // run: when the segment cannot be created (e.g. a stale one of a crashed
+  // run holds the name) every process keeps private stats instead.
+  std::unique_ptr<ipc::StatsSegment> stats;
+  try {
+    stats.reset(new ipc::StatsSegment(
+        envOr("IPC_STATS_NAME", ipc::defaultStatsName(getpid())),
+        ipc::StatsAccess::kCreate));
+    setenv("IPC_STATS_NAME", stats->name().c_str(), 1);
+    DEBUG_LOG("Stats segment " << stats->name());
+  } catch (const std::exception &e) {
+    fprintf(stderr, "warning: stats segment: %s; live stats disabled\n",
+            e.what());
+    stats.reset(new ipc::StatsSegment());
+    unsetenv("IPC_STATS_NAME");
+  }
+
+  // IPC_METRICS serves the stats in Prometheus text format while the
+  // children run; a textfile is rewritten every IPC_METRICS_INTERVAL_MS
+  std::unique_ptr<ipc::MetricsExporter> exporter;
+  const std::string metrics = envOr("IPC_METRICS", "");
+  if (!metrics.empty()) {
+    try {
+      exporter.reset(new ipc::MetricsExporter(
+          metrics, stats->layout(),
+          envOr("IPC_METRICS_INTERVAL_MS", uint64_t(1000)) * 1000000));
+    } catch (const std::exception &e) {
+      fprintf(stderr, "metrics exporter: %s\n", e.what());
+      return 1;
+    }
+  }
+
+  // Create communication pipes. Descriptors travel on IPC_LANES priority
+  // lanes, one pipe each; lane 0 is the most urgent and also carries the
+  // handshake.
+  const int lanes = static_cast<int>(std::min<uint64_t>(
+      std::max<uint64_t>(envOr("IPC_LANES", uint64_t(2)), 1), ipc::kMaxLanes));
+  std::vector<std::array<int, 2>> lane_pipes(lanes);
   int producer_done_pipe[2]; // Producer -> Consumer
   int consumer_done_pipe[2]; // Consumer -> Producer
 
-  if (pipe(tensor_pipe)) {
-    perror("tensor_pipe creation failed");
-    return 1;
+  for (auto &lane : lane_pipes) {
+    if (pipe(lane.data())) {
+      perror("lane pipe creation failed");
+      return 1;
+    }
   }
   if (pipe(producer_done_pipe)) {
     perror("producer_done_pipe creation failed");
@@ -261,9 +1958,29 @@ int main(int argc, char *argv[]) {
   }
   DEBUG_LOG("Pipes created");
 
+  // Per-lane descriptor counts the consumer spins on instead of polling the
+  // pipes. Without one the workers fall back to ppoll.
+  int doorbell_fd = -1;
+  try {
+    doorbell_fd = ipc::LaneDoorbell::create();
+  } catch (const std::exception &e) {
+    fprintf(stderr, "warning: lane doorbell: %s; spinning on ppoll\n",
+            e.what());
+  }
+  const std::string doorbell_str = std::to_string(doorbell_fd);
+
+  // Comma separated fds of one end of every lane
+  auto laneList = [&lane_pipes](int end) {
+    std::string list;
+    for (const auto &lane : lane_pipes) {
+      list += (list.empty() ? "" : ",") + std::to_string(lane[end]);
+    }
+    return list;
+  };
+
   // Prepare arguments for producer
-  char tensor_pipe_str[16], producer_done_str[16], consumer_done_str[16];
-  snprintf(tensor_pipe_str, sizeof(tensor_pipe_str), "%d", tensor_pipe[1]);
+  std::string lanes_str = laneList(1);
+  char producer_done_str[16], consumer_done_str[16];
   snprintf(producer_done_str, sizeof(producer_done_str), "%d",
            producer_done_pipe[1]);
   snprintf(consumer_done_str, sizeof(consumer_done_str), "%d",
@@ -274,9 +1991,10 @@ int main(int argc, char *argv[]) {
   pid_t producer_pid;
   char *producer_args[] = {argv[0],
                            (char *)"producer",
-                           tensor_pipe_str,
+                           &lanes_str[0],     // Write ends of the lanes
                            producer_done_str, // Write end of producer_done_pipe
                            consumer_done_str, // Read end of consumer_done_pipe
+                           (char *)doorbell_str.c_str(), // Lane doorbell
                            NULL};
 
   if (posix_spawn(&producer_pid, argv[0], NULL, NULL, producer_args, environ)) {
@@ -286,7 +2004,7 @@ int main(int argc, char *argv[]) {
   DEBUG_LOG("Producer spawned with PID: " << producer_pid);
 
   // Prepare arguments for consumer
-  snprintf(tensor_pipe_str, sizeof(tensor_pipe_str), "%d", tensor_pipe[0]);
+  lanes_str = laneList(0);
   snprintf(producer_done_str, sizeof(producer_done_str), "%d",
            producer_done_pipe[0]);
   snprintf(consumer_done_str, sizeof(consumer_done_str), "%d",
@@ -297,9 +2015,10 @@ int main(int argc, char *argv[]) {
   pid_t consumer_pid;
   char *consumer_args[] = {argv[0],
                            (char *)"consumer",
-                           tensor_pipe_str,
+                           &lanes_str[0],     // Read ends of the lanes
                            producer_done_str, // Read end of producer_done_pipe
                            consumer_done_str, // Write end of consumer_done_pipe
+                           (char *)doorbell_str.c_str(), // Lane doorbell
                            NULL};
 
   if (posix_spawn(&consumer_pid, argv[0], NULL, NULL, consumer_args, environ)) {
@@ -309,20 +2028,55 @@ int main(int argc, char *argv[]) {
   DEBUG_LOG("Consumer spawned with PID: " << consumer_pid);
 
   // Close pipe ends in parent
-  close(tensor_pipe[0]);
-  close(tensor_pipe[1]);
+  for (const auto &lane : lane_pipes) {
+    close(lane[0]);
+    close(lane[1]);
+  }
   close(producer_done_pipe[0]);
   close(producer_done_pipe[1]);
   close(consumer_done_pipe[0]);
   close(consumer_done_pipe[1]);
+  if (doorbell_fd >= 0) {
+    close(doorbell_fd);
+  }
   DEBUG_LOG("Parent closed all pipe ends");
 
-  // Wait for children
+  // Wait for children, answering metrics scrapes in the meantime
   DEBUG_LOG("Parent waiting for children");
-  waitpid(producer_pid, NULL, 0);
-  DEBUG_LOG("Producer exited");
-  waitpid(consumer_pid, NULL, 0);
-  DEBUG_LOG("Consumer exited");
+  struct Child {
+    pid_t pid;
+    const char *name;
+  } children[] = {{producer_pid, "Producer"}, {consumer_pid, "Consumer"}};
+  // A failing exporter is dropped; the children are still waited for
+  auto exportMetrics = [&exporter](bool final) {
+    try {
+      if (final) {
+        exporter->flush();
+      } else {
+        exporter->serve(100);
+      }
+    } catch (const std::exception &e) {
+      fprintf(stderr, "metrics exporter: %s\n", e.what());
+      exporter.reset();
+    }
+  };
+  int running = 2;
+  while (running > 0) {
+    if (exporter) {
+      exportMetrics(false);
+    }
+    for (Child &child : children) {
+      if (child.pid > 0 &&
+          waitpid(child.pid, NULL, exporter ? WNOHANG : 0) == child.pid) {
+        DEBUG_LOG(child.name << " exited");
+        child.pid = 0;
+        --running;
+      }
+    }
+  }
+  if (exporter) {
+    exportMetrics(true);
+  }
 
   return 0;
 }
\ No newline at end of file
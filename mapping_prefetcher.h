@@ -0,0 +1,249 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Mapping prefetch
+//
+// Opening a mapping (cudaIpcOpenMemHandle, or shm_open and mmap on the host
+// backend) is the slowest step of receiving a tensor through a new handle.
+// When descriptors queue up faster than they are processed, a background
+// thread opens the mappings of up to `depth` queued descriptors ahead of
+// demand. The worker hands it the descriptors it expects to process next,
+// in the order its scheduler will pop them, and replaces that plan as the
+// queue changes. By the time the worker gets to a descriptor, its
+// acquireOrOpen() is a cache hit.
+//
+// Each prefetched mapping lives in the mapping cache and is pinned by a
+// reference the prefetcher holds until the worker reports the descriptor
+// consumed (processed or dropped), so at most `depth` mappings are held open
+// ahead of demand. Callers keep `depth` within the mapping table's idle cache,
+// which bounds how many mappings stay open without a user. Prefetch lookups do
+// not count as uses, so release counts sent to the producer are unchanged. A
+// descriptor dropped without being processed has its use recorded on the
+// prefetched entry instead, so its release travels with the close rather than
+// ahead of it. A failed prefetch is only counted; the worker's own open then
+// reports the error.
+// =============================================================================
+
+#pragma once
+
+#include "ipc_protocol.h"
+#include "mapping_table.h"
+#include "node_pool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ipc {
+
+class MappingPrefetcher {
+public:
+  // Opens the mapping a descriptor refers to, like the worker would.
+  using OpenFn = std::function<void(const TensorDescriptor &, MappingEntry &)>;
+  // Receives an entry that became idle when the prefetcher let go of it,
+  // with its kind and hash; the entry itself may be freed at any time.
+  using IdleFn = std::function<void(MappingEntry *, uint8_t, uint64_t)>;
+
+  MappingPrefetcher(MappingTable &mappings, size_t depth, OpenFn open,
+                    IdleFn idle, std::function<void()> init = {})
+      : mappings_(mappings), depth_(depth), open_(std::move(open)),
+        idle_(std::move(idle)),
+        candidates_(PoolAllocator<TensorDescriptor>(pool_)) {
+    ready_.reserve(depth_ + 1);
+    thread_ = std::thread([this, init] {
+      if (init) {
+        init();
+      }
+      run();
+    });
+  }
+
+  MappingPrefetcher(const MappingPrefetcher &) = delete;
+  MappingPrefetcher &operator=(const MappingPrefetcher &) = delete;
+
+  ~MappingPrefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    for (const Ready &r : ready_) {
+      drop(r.entry);
+    }
+  }
+
+  // The mappable descriptors the worker expects to process next, soonest
+  // first. Replaces the previous plan; descriptors already opened or being
+  // opened are skipped.
+  void plan(const TensorDescriptor *descs, size_t count) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      candidates_.clear();
+      for (size_t i = 0; i < count; ++i) {
+        if (descs[i].index != opening_ && !isReady(descs[i].index)) {
+          candidates_.push_back(descs[i]);
+        }
+      }
+    }
+    cv_.notify_one();
+  }
+
+  // The worker processed or dropped the descriptor; releases its prefetched
+  // mapping, or cancels the prefetch if it has not started yet. An open in
+  // progress is waited for. With `count_use` the descriptor's use is added
+  // to the prefetched entry before it is released. Returns whether an entry
+  // was held; if not, the worker reports the use itself.
+  bool consumed(int32_t index, bool count_use = false) {
+    MappingEntry *entry = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      settled_.wait(lock, [&] { return opening_ != index; });
+      for (size_t i = 0; i < ready_.size(); ++i) {
+        if (ready_[i].index == index) {
+          entry = ready_[i].entry;
+          ready_[i] = ready_.back();
+          ready_.pop_back();
+          break;
+        }
+      }
+      if (entry == nullptr) {
+        for (auto it = candidates_.begin(); it != candidates_.end(); ++it) {
+          if (it->index == index) {
+            candidates_.erase(it);
+            break;
+          }
+        }
+        return false;
+      }
+      ++used_;
+    }
+    if (count_use) {
+      entry->uses.fetch_add(1, std::memory_order_relaxed);
+    }
+    drop(entry);
+    cv_.notify_one();
+    return true;
+  }
+
+  std::string summary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    out << "prefetch (depth " << depth_ << "): " << opened_
+        << " opened ahead, " << already_open_ << " already open, " << used_
+        << " used, " << failed_ << " failed\n";
+    return out.str();
+  }
+
+private:
+  struct Ready {
+    int32_t index;
+    MappingEntry *entry;
+  };
+
+  bool isReady(int32_t index) const {
+    for (const Ready &r : ready_) {
+      if (r.index == index) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void drop(MappingEntry *entry) {
+    const uint8_t kind = entry->kind;
+    const uint64_t hash = entry->hash;
+    if (mappings_.release(entry)) {
+      idle_(entry, kind, hash);
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      cv_.wait(lock, [&] {
+        return stop_ || (!candidates_.empty() && ready_.size() < depth_);
+      });
+      if (stop_) {
+        return;
+      }
+      const TensorDescriptor desc = candidates_.front();
+      candidates_.pop_front();
+      opening_ = desc.index;
+      lock.unlock();
+
+      MappingEntry *entry = nullptr;
+      bool hit = false;
+      try {
+        entry = mappings_.acquireOrOpen(
+            desc.handle, [&](MappingEntry &e) { open_(desc, e); }, hit,
+            /*count_use=*/false);
+      } catch (const std::exception &) {
+        entry = nullptr;
+      }
+
+      lock.lock();
+      opening_ = kNone;
+      if (entry == nullptr) {
+        ++failed_;
+      } else {
+        ++(hit ? already_open_ : opened_);
+        ready_.push_back({desc.index, entry});
+      }
+      settled_.notify_all();
+    }
+  }
+
+  static constexpr int32_t kNone = INT32_MIN;
+
+  MappingTable &mappings_;
+  const size_t depth_;
+  OpenFn open_;
+  IdleFn idle_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable settled_; // An open in progress finished
+  // Only touched under mutex_, so the pool needs no locking of its own.
+  // Declared before the queue so it outlives it.
+  NodePool pool_;
+  // Planned, not yet opened
+  std::deque<TensorDescriptor, PoolAllocator<TensorDescriptor>> candidates_;
+  std::vector<Ready> ready_; // Prefetched, not yet consumed
+  int32_t opening_ = kNone;
+  bool stop_ = false;
+  uint64_t opened_ = 0;
+  uint64_t already_open_ = 0;
+  uint64_t used_ = 0;
+  uint64_t failed_ = 0;
+  std::thread thread_;
+};
+
+} // namespace ipc
@@ -0,0 +1,595 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Concurrent table of opened IPC mappings
+//
+// Consumer threads look up mapped pointers by IPC handle without taking a
+// lock. Memory safety comes from epoch-based reclamation (EBR):
+// - Readers wrap lookups in an EpochManager::Guard, which publishes the global
+//   epoch they started in.
+// - Entries are unlinked under a striped writer lock and retired together
+//   with the epoch they were retired in.
+// - A retired entry is unmapped and freed only once the global epoch has
+//   advanced twice past it, i.e. once no reader can still hold it.
+//
+// An entry carries a reference count for the tensors using it. When the count
+// drops to zero the entry becomes idle. Idle entries stay mapped in a bounded
+// LRU list, so the next tensor from the same allocation is still a cache hit;
+// only the least recently idle ones beyond the limit, or all of them on
+// request, are evicted, which blocks new references, unlinks them and retires
+// them. An entry can be revived and go idle again before it is evicted, so
+// idle entries are handed over by pointer and key hash and the pointer is
+// only dereferenced once it is found linked under the bucket's lock.
+// =============================================================================
+
+#pragma once
+
+#include "handle_key.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ipc {
+
+class EpochManager {
+public:
+  static constexpr int kMaxThreads = 256;
+
+  // Pins the calling thread to the current epoch for its lifetime. Guards
+  // nest.
+  class Guard {
+  public:
+    explicit Guard(EpochManager &manager) : manager_(manager) {
+      manager_.enter();
+    }
+    ~Guard() { manager_.leave(); }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+
+  private:
+    EpochManager &manager_;
+  };
+
+  EpochManager() : id_(registerManager(true, 0)) {}
+  EpochManager(const EpochManager &) = delete;
+  EpochManager &operator=(const EpochManager &) = delete;
+
+  // Threads that used the manager may outlive it; their registrations are
+  // dropped when they exit.
+  ~EpochManager() {
+    registerManager(false, id_);
+    for (auto &r : retired_) {
+      r.fn();
+    }
+  }
+
+  // Schedules `fn` to run once every reader that could observe the retired
+  // object has left its critical section.
+  void retire(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    retired_.push_back({global_.load(std::memory_order_acquire), std::move(fn)});
+  }
+
+  // Advances the epoch when possible and runs every retired callback whose
+  // grace period has elapsed. Returns the number of callbacks run.
+  size_t reclaim() {
+    tryAdvance();
+    uint64_t safe = global_.load(std::memory_order_acquire);
+    std::vector<Retired> ready;
+    {
+      std::lock_guard<std::mutex> lock(retired_mutex_);
+      size_t keep = 0;
+      for (size_t i = 0; i < retired_.size(); ++i) {
+        if (retired_[i].epoch + 2 <= safe) {
+          ready.push_back(std::move(retired_[i]));
+        } else {
+          retired_[keep++] = std::move(retired_[i]);
+        }
+      }
+      retired_.resize(keep);
+    }
+    for (auto &r : ready) {
+      r.fn();
+    }
+    return ready.size();
+  }
+
+  size_t pending() const {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    return retired_.size();
+  }
+
+private:
+  static constexpr uint64_t kQuiescent = ~0ull;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{kQuiescent};
+    std::atomic<bool> used{false};
+  };
+
+  struct Retired {
+    uint64_t epoch;
+    std::function<void()> fn;
+  };
+
+  // A thread's slot in one manager. Managers are told apart by id, since a
+  // new one may reuse the address of a destroyed one.
+  struct Registration {
+    EpochManager *owner;
+    uint64_t id;
+    int slot;
+    int depth;
+  };
+
+  // Per-thread registrations, released when the thread exits if their
+  // manager is still alive.
+  struct ThreadState {
+    std::vector<Registration> registrations;
+    ~ThreadState() {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      for (const Registration &r : registrations) {
+        if (isLive(r.id)) {
+          r.owner->slots_[r.slot].used.store(false,
+                                             std::memory_order_release);
+        }
+      }
+    }
+  };
+
+  static ThreadState &threadState() {
+    static thread_local ThreadState state;
+    return state;
+  }
+
+  static std::mutex &registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  // Ids of the managers alive right now; guarded by registryMutex()
+  static std::vector<uint64_t> &liveIds() {
+    static std::vector<uint64_t> ids;
+    return ids;
+  }
+
+  static bool isLive(uint64_t id) {
+    const std::vector<uint64_t> &ids = liveIds();
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+  }
+
+  // Adds a new manager and returns its id, or removes manager `id`
+  static uint64_t registerManager(bool add, uint64_t id) {
+    static uint64_t next_id = 0;
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::vector<uint64_t> &ids = liveIds();
+    if (add) {
+      ids.push_back(++next_id);
+      return next_id;
+    }
+    ids.erase(std::find(ids.begin(), ids.end(), id));
+    return id;
+  }
+
+  // The calling thread's registration with this manager, claimed on first
+  // use. Registrations of destroyed managers are pruned then.
+  Registration &registration() {
+    std::vector<Registration> &regs = threadState().registrations;
+    for (Registration &r : regs) {
+      if (r.owner == this && r.id == id_) {
+        return r;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      size_t keep = 0;
+      for (size_t i = 0; i < regs.size(); ++i) {
+        if (isLive(regs[i].id)) {
+          regs[keep++] = regs[i];
+        }
+      }
+      regs.resize(keep);
+    }
+    regs.push_back({this, id_, claimSlot(), 0});
+    return regs.back();
+  }
+
+  int claimSlot() {
+    for (int i = 0; i < kMaxThreads; ++i) {
+      bool expected = false;
+      if (!slots_[i].used.load(std::memory_order_relaxed) &&
+          slots_[i].used.compare_exchange_strong(expected, true)) {
+        return i;
+      }
+    }
+    throw std::runtime_error("EpochManager: too many threads");
+  }
+
+  void enter() {
+    Registration &r = registration();
+    if (r.depth++ == 0) {
+      slots_[r.slot].epoch.store(global_.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void leave() {
+    Registration &r = registration();
+    if (--r.depth == 0) {
+      slots_[r.slot].epoch.store(kQuiescent, std::memory_order_release);
+    }
+  }
+
+  void tryAdvance() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t current = global_.load(std::memory_order_relaxed);
+    for (auto &slot : slots_) {
+      uint64_t e = slot.epoch.load(std::memory_order_acquire);
+      if (e != kQuiescent && e != current) {
+        return;
+      }
+    }
+    global_.compare_exchange_strong(current, current + 1);
+  }
+
+  const uint64_t id_;
+  alignas(64) std::atomic<uint64_t> global_{0};
+  Slot slots_[kMaxThreads];
+  mutable std::mutex retired_mutex_;
+  std::vector<Retired> retired_;
+};
+
+struct MappingEntry {
+  uint8_t key[kHandleSize];
+  uint64_t hash;
+  void *ptr;        // Mapped pointer handed to tensors
+  uint64_t size;
+  uint8_t kind;     // Transport the mapping was opened with
+  int32_t release_id; // Reported to the producer after the close; negative
+                      // to skip
+  std::atomic<uint32_t> uses;  // Lookups served, reported with the release
+  std::atomic<uint64_t> state; // Reference count | kEvicting
+  std::atomic<MappingEntry *> next;
+  // Idle LRU links, guarded by the table's idle lock. An entry on the list
+  // is always linked in its bucket.
+  MappingEntry *idle_prev;
+  MappingEntry *idle_next;
+  bool idle_listed;
+
+  static constexpr uint64_t kEvicting = 1ull << 63;
+};
+
+// Bucket count for a table expected to hold `open` mappings at once: the
+// next power of two at or above it, so chains stay about one entry long.
+inline size_t mappingTableBuckets(size_t open) {
+  size_t buckets = 64;
+  while (buckets < open) {
+    buckets <<= 1;
+  }
+  return buckets;
+}
+
+class MappingTable {
+public:
+  // Fills in ptr, size, kind and release_id of a new entry; throws on error.
+  using OpenFn = std::function<void(MappingEntry &)>;
+  // Unmaps an evicted entry after its grace period.
+  using CloseFn = std::function<void(MappingEntry &)>;
+
+  // Up to `idle_limit` idle entries stay mapped; zero evicts every entry as
+  // soon as it goes idle. The bucket count is fixed, so size it with
+  // mappingTableBuckets() for the mappings expected to be open at once.
+  MappingTable(EpochManager &epochs, CloseFn close, size_t idle_limit = 0,
+               size_t buckets_pow2 = 4096)
+      : epochs_(epochs), close_(std::move(close)), idle_limit_(idle_limit),
+        mask_(buckets_pow2 - 1),
+        buckets_(new std::atomic<MappingEntry *>[buckets_pow2]) {
+    for (size_t i = 0; i < buckets_pow2; ++i) {
+      buckets_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  MappingTable(const MappingTable &) = delete;
+  MappingTable &operator=(const MappingTable &) = delete;
+
+  ~MappingTable() {
+    // Retired entries call back into this table
+    while (epochs_.pending() > 0) {
+      epochs_.reclaim();
+    }
+    for (size_t i = 0; i <= mask_; ++i) {
+      MappingEntry *e = buckets_[i].load(std::memory_order_relaxed);
+      while (e != nullptr) {
+        MappingEntry *next = e->next.load(std::memory_order_relaxed);
+        close_(*e);
+        delete e;
+        e = next;
+      }
+    }
+  }
+
+  static uint64_t hashKey(const void *key) { return hashHandleBytes(key); }
+
+  // Lock-free lookup. Returns the entry with a reference taken, or nullptr.
+  MappingEntry *acquire(const void *key) {
+    uint64_t hash = hashKey(key);
+    EpochManager::Guard guard(epochs_);
+    return find(key, hash);
+  }
+
+  // Returns a referenced entry for `key`, opening the mapping with `open` if
+  // no live entry exists. `hit` reports whether an existing mapping was
+  // reused. Only one thread opens a given key at a time. A prefetch passes
+  // `count_use` false, so the producer is not told about a use that no
+  // descriptor made.
+  MappingEntry *acquireOrOpen(const void *key, const OpenFn &open, bool &hit,
+                              bool count_use = true) {
+    uint64_t hash = hashKey(key);
+    {
+      EpochManager::Guard guard(epochs_);
+      if (MappingEntry *e = find(key, hash, count_use)) {
+        hit = true;
+        return e;
+      }
+    }
+    hit = false;
+    Stripe &stripe = stripeFor(hash);
+    for (;;) {
+      std::unique_lock<std::mutex> lock(stripe.mutex);
+      {
+        EpochManager::Guard guard(epochs_);
+        if (MappingEntry *e = find(key, hash, count_use)) {
+          hit = true;
+          return e;
+        }
+      }
+      // A previous mapping of the same handle must be closed before the
+      // handle can be opened again
+      if (stripe.isClosing(key)) {
+        lock.unlock();
+        std::this_thread::yield();
+        continue;
+      }
+      MappingEntry *e = new MappingEntry();
+      memcpy(e->key, key, kHandleSize);
+      e->hash = hash;
+      e->ptr = nullptr;
+      e->size = 0;
+      e->kind = 0;
+      e->release_id = -1;
+      e->uses.store(count_use ? 1 : 0, std::memory_order_relaxed);
+      e->state.store(1, std::memory_order_relaxed);
+      e->idle_prev = nullptr;
+      e->idle_next = nullptr;
+      e->idle_listed = false;
+      try {
+        open(*e);
+      } catch (...) {
+        delete e;
+        throw;
+      }
+      std::atomic<MappingEntry *> &head = buckets_[hash & mask_];
+      e->next.store(head.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+      head.store(e, std::memory_order_release);
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return e;
+    }
+  }
+
+  // Drops one reference. Returns true when the entry became idle and should
+  // be handed to retainIdle() or evictIfIdle() together with its hash.
+  bool release(MappingEntry *e) {
+    return e->state.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  // Adds a reference to an entry the caller already holds one on.
+  void addRef(MappingEntry *e) {
+    e->state.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Keeps an entry that went idle mapped as the most recently idle one, then
+  // evicts the least recently idle entries beyond the limit. Same contract
+  // for `e` as evictIfIdle().
+  void retainIdle(MappingEntry *e, uint64_t hash) {
+    {
+      Stripe &stripe = stripeFor(hash);
+      std::lock_guard<std::mutex> lock(stripe.mutex);
+      if (linkTo(e, hash) == nullptr) {
+        return;
+      }
+      std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+      if (e->idle_listed) {
+        unlistIdle(e);
+      }
+      e->idle_prev = nullptr;
+      e->idle_next = idle_head_;
+      (idle_head_ != nullptr ? idle_head_->idle_prev : idle_tail_) = e;
+      idle_head_ = e;
+      e->idle_listed = true;
+      ++idle_count_;
+    }
+    trimIdle(idle_limit_);
+  }
+
+  // Evicts the least recently idle entries until at most `keep` remain.
+  // Entries revived since they went idle leave the list without being
+  // evicted. Returns the number evicted.
+  size_t trimIdle(size_t keep) {
+    size_t evicted = 0;
+    for (;;) {
+      MappingEntry *victim;
+      uint64_t hash;
+      {
+        std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+        if (idle_count_ <= keep) {
+          return evicted;
+        }
+        victim = idle_tail_;
+        hash = victim->hash;
+      }
+      evicted += evictIfIdle(victim, hash) ? 1 : 0;
+    }
+  }
+
+  // Unlinks and retires the entry unless it was revived in the meantime.
+  // `e` may already have been evicted and freed by an earlier request for
+  // the same idle period; it is only touched if still linked under `hash`.
+  bool evictIfIdle(MappingEntry *e, uint64_t hash) {
+    Stripe &stripe = stripeFor(hash);
+    {
+      std::lock_guard<std::mutex> lock(stripe.mutex);
+      std::atomic<MappingEntry *> *link = linkTo(e, hash);
+      if (link == nullptr) {
+        return false;
+      }
+      {
+        std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+        if (e->idle_listed) {
+          unlistIdle(e);
+        }
+      }
+      uint64_t expected = 0;
+      if (!e->state.compare_exchange_strong(expected, MappingEntry::kEvicting,
+                                            std::memory_order_acq_rel)) {
+        return false;
+      }
+      link->store(e->next.load(std::memory_order_relaxed),
+                  std::memory_order_release);
+      stripe.closing.push_back(e);
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    epochs_.retire([this, e] {
+      close_(*e);
+      Stripe &s = stripeFor(e->hash);
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (size_t i = 0; i < s.closing.size(); ++i) {
+          if (s.closing[i] == e) {
+            s.closing[i] = s.closing.back();
+            s.closing.pop_back();
+            break;
+          }
+        }
+      }
+      delete e;
+    });
+    return true;
+  }
+
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  size_t idleSize() const {
+    std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+    return idle_count_;
+  }
+
+private:
+  static constexpr size_t kNumStripes = 64;
+
+  struct alignas(64) Stripe {
+    std::mutex mutex;
+    std::vector<MappingEntry *> closing; // Unlinked, not yet unmapped
+
+    bool isClosing(const void *key) const {
+      for (const MappingEntry *e : closing) {
+        if (handleBytesEqual(e->key, key)) {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  Stripe &stripeFor(uint64_t hash) {
+    // Entries sharing a bucket chain must share a lock
+    return stripes_[(hash & mask_) % kNumStripes];
+  }
+
+  // The link that points at `e` in the bucket of `hash`, or nullptr when `e`
+  // is not linked there. Must run under the bucket's stripe lock.
+  std::atomic<MappingEntry *> *linkTo(MappingEntry *e, uint64_t hash) {
+    std::atomic<MappingEntry *> *link = &buckets_[hash & mask_];
+    MappingEntry *cur = link->load(std::memory_order_relaxed);
+    while (cur != nullptr && cur != e) {
+      link = &cur->next;
+      cur = link->load(std::memory_order_relaxed);
+    }
+    return cur != nullptr ? link : nullptr;
+  }
+
+  // Must run under the idle lock.
+  void unlistIdle(MappingEntry *e) {
+    (e->idle_prev != nullptr ? e->idle_prev->idle_next : idle_head_) =
+        e->idle_next;
+    (e->idle_next != nullptr ? e->idle_next->idle_prev : idle_tail_) =
+        e->idle_prev;
+    e->idle_listed = false;
+    --idle_count_;
+  }
+
+  // Must run inside an epoch guard.
+  MappingEntry *find(const void *key, uint64_t hash, bool count_use = true) {
+    for (MappingEntry *e =
+             buckets_[hash & mask_].load(std::memory_order_acquire);
+         e != nullptr; e = e->next.load(std::memory_order_acquire)) {
+      if (e->hash != hash || !handleBytesEqual(e->key, key)) {
+        continue;
+      }
+      uint64_t state = e->state.load(std::memory_order_acquire);
+      while (!(state & MappingEntry::kEvicting)) {
+        if (e->state.compare_exchange_weak(state, state + 1,
+                                           std::memory_order_acq_rel)) {
+          if (count_use) {
+            e->uses.fetch_add(1, std::memory_order_relaxed);
+          }
+          return e;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  EpochManager &epochs_;
+  CloseFn close_;
+  const size_t idle_limit_;
+  const size_t mask_;
+  std::unique_ptr<std::atomic<MappingEntry *>[]> buckets_;
+  Stripe stripes_[kNumStripes];
+  std::atomic<size_t> size_{0};
+  // Taken after a stripe lock, never before one
+  mutable std::mutex idle_mutex_;
+  MappingEntry *idle_head_ = nullptr; // Most recently idle
+  MappingEntry *idle_tail_ = nullptr;
+  size_t idle_count_ = 0;
+};
+
+} // namespace ipc
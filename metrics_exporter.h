@@ -0,0 +1,420 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Prometheus metrics exporter
+//
+// Renders the workers' stats segment, including the consumer's per-tenant
+// counters, in the Prometheus text exposition format (version 0.0.4) and
+// publishes it from the parent process in one of three ways, chosen by
+// IPC_METRICS:
+// - unix:PATH  HTTP on a Unix domain socket
+// - tcp:PORT   HTTP on 127.0.0.1:PORT
+// - file:PATH  a textfile-collector file, rewritten atomically (write to a
+//              temporary file, then rename) every interval and on exit
+//
+// The HTTP side answers GET /metrics one connection at a time from the
+// parent's wait loop; the workers are never involved in a scrape. A client
+// gets kAnswerDeadlineMs for its whole exchange and is dropped after that,
+// so a slow or idle one cannot hold up reaping the children.
+// =============================================================================
+
+#pragma once
+
+#include "monotonic_clock.h"
+#include "stats_segment.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ipc {
+
+namespace detail {
+
+inline void writeMetricHeader(std::ostream &out, const char *name,
+                              const char *type, const char *help) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << ' ' << type << '\n';
+}
+
+// Stages each worker records, so every series exists from the first scrape
+inline bool stageOfRole(Stage stage, StatsRole role) {
+  const bool producer = stage == Stage::kAdmit || stage == Stage::kSend;
+  return producer == (role == StatsRole::kProducer);
+}
+
+} // namespace detail
+
+inline std::string renderPrometheus(const StatsLayout &layout,
+                                    uint64_t now_ns) {
+  std::ostringstream out;
+  out.precision(9);
+  using Field = const StatCounter WorkerStats::*;
+  struct Series {
+    const char *name;
+    const char *type;
+    const char *help;
+    Field field;
+  };
+  static const Series kSeries[] = {
+      {"cipc_tensors_total", "counter",
+       "Tensors sent by the producer or received by the consumer.",
+       &WorkerStats::tensors},
+      {"cipc_bytes_total", "counter", "Tensor bytes sent or received.",
+       &WorkerStats::bytes},
+      {"cipc_dropped_total", "counter",
+       "Expired tensors dropped without being processed.",
+       &WorkerStats::dropped},
+      {"cipc_mapping_cache_hits_total", "counter",
+       "Descriptors served by an already open mapping.",
+       &WorkerStats::cache_hits},
+      {"cipc_mapping_cache_misses_total", "counter",
+       "Descriptors that had to open a mapping.", &WorkerStats::cache_misses},
+      {"cipc_integrity_failures_total", "counter",
+       "Tensors that failed a checksum or content check.",
+       &WorkerStats::integrity_failures},
+      {"cipc_in_flight_buffers", "gauge",
+       "Producer buffers the consumer may still use.",
+       &WorkerStats::in_flight},
+      {"cipc_open_mappings", "gauge", "Mappings the consumer holds open.",
+       &WorkerStats::open_mappings},
+      {"cipc_queue_depth", "gauge", "Descriptors waiting to be processed.",
+       &WorkerStats::queue_depth},
+  };
+
+  detail::writeMetricHeader(out, "cipc_uptime_seconds", "gauge",
+                            "Time since the sample started.");
+  out << "cipc_uptime_seconds " << (now_ns - layout.start_ns) / 1e9 << '\n';
+  detail::writeMetricHeader(out, "cipc_worker_pid", "gauge",
+                            "Process id of each worker, 0 before it starts.");
+  for (int r = 0; r < kStatsRoles; ++r) {
+    out << "cipc_worker_pid{role=\"" << statsRoleName(StatsRole(r)) << "\"} "
+        << layout.workers[r].pid.load(std::memory_order_relaxed) << '\n';
+  }
+  for (const Series &series : kSeries) {
+    detail::writeMetricHeader(out, series.name, series.type, series.help);
+    for (int r = 0; r < kStatsRoles; ++r) {
+      out << series.name << "{role=\"" << statsRoleName(StatsRole(r))
+          << "\"} " << statGet(layout.workers[r].*series.field) << '\n';
+    }
+  }
+
+  // The consumer's tenant scheduler, one series per published tenant slot
+  using TenantField = const StatCounter TenantStats::*;
+  struct TenantSeries {
+    const char *name;
+    const char *type;
+    const char *help;
+    TenantField field;
+  };
+  static const TenantSeries kTenantSeries[] = {
+      {"cipc_tenant_queued", "gauge",
+       "Descriptors of the tenant waiting to be processed.",
+       &TenantStats::queued},
+      {"cipc_tenant_dispatched_total", "counter",
+       "Descriptors of the tenant handed to the consumer.",
+       &TenantStats::dispatched},
+      {"cipc_tenant_dispatched_bytes_total", "counter",
+       "Tensor bytes of the tenant handed to the consumer.",
+       &TenantStats::dispatched_bytes},
+      {"cipc_tenant_expired_total", "counter",
+       "Descriptors of the tenant dispatched after their deadline.",
+       &TenantStats::expired},
+      {"cipc_tenant_quota_blocked_total", "counter",
+       "Scheduling turns the tenant sat out over its quota.",
+       &TenantStats::quota_blocked},
+      {"cipc_tenant_held_bytes", "gauge",
+       "Bytes of the tenant's tensors the consumer still holds.",
+       &TenantStats::held_bytes},
+      {"cipc_tenant_held_handles", "gauge",
+       "Tensors of the tenant the consumer still holds.",
+       &TenantStats::held_handles},
+  };
+  uint32_t tenants = layout.tenant_count.load(std::memory_order_acquire);
+  tenants = tenants < kStatsTenants ? tenants : kStatsTenants;
+  for (const TenantSeries &series : kTenantSeries) {
+    detail::writeMetricHeader(out, series.name, series.type, series.help);
+    for (uint32_t t = 0; t < tenants; ++t) {
+      const TenantStats &slot = layout.tenants[t];
+      const uint32_t id = slot.id.load(std::memory_order_relaxed);
+      out << series.name << "{tenant=\"";
+      if (id == kOtherTenants) {
+        out << "other";
+      } else {
+        out << id;
+      }
+      out << "\"} " << statGet(slot.*series.field) << '\n';
+    }
+  }
+
+  // Bucket k holds samples below 2^k us, so cumulative counts map directly
+  // onto "le" bounds; the last bucket only contributes to +Inf
+  detail::writeMetricHeader(out, "cipc_stage_latency_seconds", "histogram",
+                            "Time a tensor spent in each stage.");
+  for (int r = 0; r < kStatsRoles; ++r) {
+    const StatsRole role = StatsRole(r);
+    for (int k = 0; k < kStages; ++k) {
+      const Stage stage = Stage(k);
+      if (!detail::stageOfRole(stage, role)) {
+        continue;
+      }
+      const LatencyHistogram &h = layout.workers[r].stage(stage);
+      const std::string labels = std::string("role=\"") +
+                                 statsRoleName(role) + "\",stage=\"" +
+                                 stageName(stage) + "\"";
+      uint64_t cumulative = 0;
+      for (int b = 0; b < kLatencyBuckets; ++b) {
+        cumulative += statGet(h.buckets[b]);
+        if (b + 1 < kLatencyBuckets) {
+          out << "cipc_stage_latency_seconds_bucket{" << labels << ",le=\""
+              << latencyBucketUs(b) / 1e6 << "\"} " << cumulative << '\n';
+        }
+      }
+      // The buckets, not `count`, define the total so +Inf and _count agree
+      // even while the worker is mid-update
+      out << "cipc_stage_latency_seconds_bucket{" << labels
+          << ",le=\"+Inf\"} " << cumulative << '\n'
+          << "cipc_stage_latency_seconds_sum{" << labels << "} "
+          << statGet(h.sum_ns) / 1e9 << '\n'
+          << "cipc_stage_latency_seconds_count{" << labels << "} "
+          << cumulative << '\n';
+    }
+  }
+  return out.str();
+}
+
+class MetricsExporter {
+public:
+  MetricsExporter(const std::string &target, const StatsLayout &layout,
+                  uint64_t interval_ns)
+      : layout_(layout), interval_ns_(interval_ns) {
+    const size_t colon = target.find(':');
+    const std::string kind = target.substr(0, colon);
+    const std::string where =
+        colon == std::string::npos ? "" : target.substr(colon + 1);
+    if (where.empty()) {
+      throw std::runtime_error("IPC_METRICS needs unix:PATH, tcp:PORT or "
+                               "file:PATH, got " + target);
+    }
+    if (kind == "file") {
+      path_ = where;
+    } else if (kind == "unix") {
+      listenUnix(where);
+    } else if (kind == "tcp") {
+      listenTcp(atoi(where.c_str()));
+    } else {
+      throw std::runtime_error("Unknown IPC_METRICS kind " + kind);
+    }
+  }
+
+  MetricsExporter(const MetricsExporter &) = delete;
+  MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+  ~MetricsExporter() {
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+    if (!socket_path_.empty()) {
+      unlink(socket_path_.c_str());
+    }
+  }
+
+  // Waits up to `timeout_ms` for a scrape and answers it; rewrites the
+  // textfile once its interval has passed.
+  void serve(int timeout_ms) {
+    if (listen_fd_ < 0) {
+      if (monotonicNs() >= next_write_ns_) {
+        flush();
+      }
+      usleep(static_cast<useconds_t>(timeout_ms) * 1000);
+      return;
+    }
+    struct pollfd pfd = {listen_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) > 0) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd >= 0) {
+        answer(fd);
+        close(fd);
+      }
+    }
+  }
+
+  // Writes the textfile now; a no-op for HTTP targets.
+  void flush() {
+    if (path_.empty()) {
+      return;
+    }
+    const std::string tmp = path_ + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "w");
+    if (file == nullptr) {
+      throw std::runtime_error("Cannot write " + tmp + ": " +
+                               strerror(errno));
+    }
+    const std::string text = renderPrometheus(layout_, monotonicNs());
+    const bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (fclose(file) != 0 || !ok || rename(tmp.c_str(), path_.c_str()) != 0) {
+      int err = errno;
+      unlink(tmp.c_str());
+      throw std::runtime_error("Cannot write " + path_ + ": " +
+                               strerror(err));
+    }
+    next_write_ns_ = monotonicNs() + interval_ns_;
+  }
+
+private:
+  static constexpr int kAnswerDeadlineMs = 5;
+
+  void listenUnix(const std::string &path) {
+    struct sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("Metrics socket path too long: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bindAndListen(reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr),
+                  path);
+    socket_path_ = path;
+  }
+
+  void listenTcp(int port) {
+    if (port <= 0 || port > 65535) {
+      throw std::runtime_error("Invalid metrics port " +
+                               std::to_string(port));
+    }
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (listen_fd_ >= 0) {
+      setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    bindAndListen(reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr),
+                  "127.0.0.1:" + std::to_string(port));
+  }
+
+  void bindAndListen(const struct sockaddr *addr, socklen_t len,
+                     const std::string &where) {
+    if (listen_fd_ < 0 || bind(listen_fd_, addr, len) != 0 ||
+        listen(listen_fd_, 16) != 0) {
+      int err = errno;
+      if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+      }
+      throw std::runtime_error("Cannot serve metrics on " + where + ": " +
+                               strerror(err));
+    }
+  }
+
+  // Waits for `events` on the non-blocking `fd` until `deadline_ns`.
+  static bool waitUntil(int fd, short events, uint64_t deadline_ns) {
+    const uint64_t now_ns = monotonicNs();
+    if (now_ns >= deadline_ns) {
+      return false;
+    }
+    struct pollfd pfd = {fd, events, 0};
+    const int timeout_ms =
+        static_cast<int>((deadline_ns - now_ns + 999999) / 1000000);
+    return poll(&pfd, 1, timeout_ms) > 0;
+  }
+
+  // Minimal HTTP/1.0: reads the request line and answers it, all within
+  // kAnswerDeadlineMs of the accept
+  void answer(int fd) {
+    const uint64_t deadline_ns =
+        monotonicNs() + uint64_t(kAnswerDeadlineMs) * 1000000;
+    char request[1024];
+    size_t used = 0;
+    while (used < sizeof(request) - 1 &&
+           memchr(request, '\n', used) == nullptr) {
+      ssize_t n = read(fd, request + used, sizeof(request) - 1 - used);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        if (!waitUntil(fd, POLLIN, deadline_ns)) {
+          return;
+        }
+        continue;
+      }
+      if (n <= 0) {
+        return;
+      }
+      used += static_cast<size_t>(n);
+    }
+    request[used] = '\0';
+    std::string status = "200 OK";
+    std::string body;
+    if (strncmp(request, "GET ", 4) != 0) {
+      status = "405 Method Not Allowed";
+    } else if (strncmp(request + 4, "/metrics ", 9) != 0 &&
+               strncmp(request + 4, "/ ", 2) != 0) {
+      status = "404 Not Found";
+    } else {
+      body = renderPrometheus(layout_, monotonicNs());
+    }
+    std::string response = "HTTP/1.0 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4"
+                           "\r\nContent-Length: " +
+                           std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+    const char *p = response.data();
+    size_t left = response.size();
+    while (left > 0) {
+      ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        if (!waitUntil(fd, POLLOUT, deadline_ns)) {
+          return;
+        }
+        continue;
+      }
+      if (n <= 0) {
+        return;
+      }
+      p += n;
+      left -= static_cast<size_t>(n);
+    }
+  }
+
+  const StatsLayout &layout_;
+  uint64_t interval_ns_;
+  std::string path_;        // Textfile target
+  std::string socket_path_; // Unix socket to remove on exit
+  int listen_fd_ = -1;
+  uint64_t next_write_ns_ = 0;
+};
+
+} // namespace ipc
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Node pool for standard containers
+//
+// Node based containers (std::set, std::map, std::unordered_map, std::deque)
+// allocate on every insert and free on every erase. NodePool keeps the
+// freed blocks on a free list per block size and hands them out again, so a
+// container whose size stays bounded stops touching the heap once it has
+// reached its working set. PoolAllocator plugs a pool into any standard
+// container; the pool must outlive the containers using it.
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace ipc {
+
+class NodePool {
+public:
+  NodePool() = default;
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  ~NodePool() {
+    for (List &list : lists_) {
+      while (list.head != nullptr) {
+        Block *next = list.head->next;
+        ::operator delete(list.head);
+        list.head = next;
+      }
+    }
+  }
+
+  void *allocate(size_t bytes) {
+    List &list = listFor(bytes);
+    if (list.head != nullptr) {
+      Block *block = list.head;
+      list.head = block->next;
+      return block;
+    }
+    return ::operator new(std::max(bytes, sizeof(Block)));
+  }
+
+  void deallocate(void *ptr, size_t bytes) {
+    List &list = listFor(bytes);
+    Block *block = static_cast<Block *>(ptr);
+    block->next = list.head;
+    list.head = block;
+  }
+
+private:
+  struct Block {
+    Block *next;
+  };
+
+  struct List {
+    size_t bytes;
+    Block *head;
+  };
+
+  // Containers use a handful of distinct sizes, so a linear scan is fine
+  List &listFor(size_t bytes) {
+    for (List &list : lists_) {
+      if (list.bytes == bytes) {
+        return list;
+      }
+    }
+    lists_.push_back({bytes, nullptr});
+    return lists_.back();
+  }
+
+  std::vector<List> lists_;
+};
+
+template <typename T> class PoolAllocator {
+public:
+  using value_type = T;
+
+  explicit PoolAllocator(NodePool &pool) : pool_(&pool) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool()) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(pool_->allocate(n * sizeof(T)));
+  }
+  void deallocate(T *ptr, size_t n) { pool_->deallocate(ptr, n * sizeof(T)); }
+
+  NodePool *pool() const { return pool_; }
+
+  template <typename U> bool operator==(const PoolAllocator<U> &o) const {
+    return pool_ == o.pool();
+  }
+  template <typename U> bool operator!=(const PoolAllocator<U> &o) const {
+    return pool_ != o.pool();
+  }
+
+private:
+  NodePool *pool_;
+};
+
+} // namespace ipc
@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Priority lanes for the control channel
+//
+// Descriptors travel on several independent pipes ("lanes") instead of one
+// FIFO, so a latency-critical descriptor never queues behind a burst of bulk
+// ones. The producer picks a lane from the tensor size; the consumer drains
+// the lanes that have data either in strict priority order (lane 0 first) or
+// with smooth weighted round robin.
+// =============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace ipc {
+
+constexpr int kMaxLanes = 8;
+
+enum class LanePolicy { kStrict, kWeighted };
+
+inline std::vector<uint64_t> parseUintList(const std::string &text) {
+  std::vector<uint64_t> values;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find(',', pos);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    if (end > pos) {
+      values.push_back(
+          strtoull(text.substr(pos, end - pos).c_str(), nullptr, 0));
+    }
+    pos = end + 1;
+  }
+  return values;
+}
+
+// Lane for a tensor of `nbytes`: the first lane whose threshold is at least
+// the size, or the last lane.
+inline int laneForSize(uint64_t nbytes, const std::vector<uint64_t> &thresholds,
+                       int lanes) {
+  for (size_t i = 0; i < thresholds.size() && static_cast<int>(i) < lanes - 1;
+       ++i) {
+    if (nbytes <= thresholds[i]) {
+      return static_cast<int>(i);
+    }
+  }
+  return lanes - 1;
+}
+
+class LaneScheduler {
+public:
+  LaneScheduler(LanePolicy policy, std::vector<uint64_t> weights, int lanes)
+      : policy_(policy), lanes_(lanes) {
+    for (int i = 0; i < lanes_; ++i) {
+      weights_[i] = i < static_cast<int>(weights.size()) && weights[i] > 0
+                        ? static_cast<int64_t>(weights[i])
+                        : 1;
+      current_[i] = 0;
+    }
+  }
+
+  // Picks one of the lanes whose bit is set in `ready`; -1 when none is.
+  int pick(uint32_t ready) {
+    if (ready == 0) {
+      return -1;
+    }
+    if (policy_ == LanePolicy::kStrict) {
+      return __builtin_ctz(ready);
+    }
+    // Smooth weighted round robin over the ready lanes
+    int best = -1;
+    int64_t total = 0;
+    for (int i = 0; i < lanes_; ++i) {
+      if (!(ready & (1u << i))) {
+        continue;
+      }
+      current_[i] += weights_[i];
+      total += weights_[i];
+      if (best < 0 || current_[i] > current_[best]) {
+        best = i;
+      }
+    }
+    current_[best] -= total;
+    return best;
+  }
+
+  int lanes() const { return lanes_; }
+
+private:
+  LanePolicy policy_;
+  int lanes_;
+  int64_t weights_[kMaxLanes];
+  int64_t current_[kMaxLanes];
+};
+
+} // namespace ipc
@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Producer admission control
+//
+// TokenBucket enforces a sustained rate with a bounded burst; costs are
+// tensors or bytes depending on the bucket. Watermark adds hysteresis to a
+// level such as the bytes the consumer still maps: it trips above the high
+// mark and only clears again below the low mark, so the producer does not
+// flap around a single threshold.
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+
+namespace ipc {
+
+class TokenBucket {
+public:
+  // A zero rate disables the bucket.
+  TokenBucket(double rate_per_s, double burst)
+      : rate_per_ns_(rate_per_s / 1e9), burst_(std::max(burst, 1.0)),
+        tokens_(burst_) {}
+
+  bool enabled() const { return rate_per_ns_ > 0; }
+
+  // Nanoseconds to wait at `now_ns` before `cost` may be consumed. A cost
+  // larger than the burst is admitted once the bucket is full and leaves it
+  // in debt, so oversized items are slowed down rather than refused.
+  uint64_t delayNs(double cost, uint64_t now_ns) {
+    if (!enabled()) {
+      return 0;
+    }
+    refill(now_ns);
+    double needed = std::min(cost, burst_) - tokens_;
+    return needed <= 0 ? 0 : static_cast<uint64_t>(needed / rate_per_ns_) + 1;
+  }
+
+  void consume(double cost, uint64_t now_ns) {
+    if (!enabled()) {
+      return;
+    }
+    refill(now_ns);
+    tokens_ -= cost;
+  }
+
+private:
+  void refill(uint64_t now_ns) {
+    if (last_ns_ != 0 && now_ns > last_ns_) {
+      tokens_ = std::min(burst_, tokens_ + (now_ns - last_ns_) * rate_per_ns_);
+    }
+    last_ns_ = now_ns;
+  }
+
+  double rate_per_ns_;
+  double burst_;
+  double tokens_;
+  uint64_t last_ns_ = 0;
+};
+
+class Watermark {
+public:
+  // A zero high mark disables the watermark. The low mark is clamped below
+  // the high one.
+  Watermark(uint64_t high, uint64_t low)
+      : high_(high), low_(std::min(low, high > 0 ? high - 1 : 0)) {}
+
+  bool enabled() const { return high_ > 0; }
+
+  // Updates the state for the current `level` and returns true while
+  // admission should stay paused.
+  bool paused(uint64_t level) {
+    if (!enabled()) {
+      return false;
+    }
+    if (paused_ ? level < low_ : level < high_) {
+      paused_ = false;
+    } else {
+      if (!paused_) {
+        ++trips_;
+      }
+      paused_ = true;
+    }
+    return paused_;
+  }
+
+  uint64_t trips() const { return trips_; }
+
+private:
+  uint64_t high_;
+  uint64_t low_;
+  bool paused_ = false;
+  uint64_t trips_ = 0;
+};
+
+inline void sleepNs(uint64_t ns) {
+  struct timespec ts;
+  ts.tv_sec = ns / 1000000000;
+  ts.tv_nsec = ns % 1000000000;
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+} // namespace ipc
@@ -0,0 +1,245 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Shared memory message ring
+//
+// Single-producer single-consumer ring of fixed-size slots in memory shared
+// by two processes. Head and tail are monotonically increasing counters on
+// separate cache lines, so a send or receive that does not have to wait
+// touches no kernel object at all.
+//
+// A side that finds the ring empty (receiver) or full (sender) first spins
+// for the budget its AdaptiveSpin gives and then sleeps. The sleeping side
+// raises a waiter flag before it re-checks the ring; the other side only
+// makes a wake-up system call when it sees that flag, so a busy ring runs
+// without system calls. Two wake-up mechanisms are supported:
+// - kEventfd: one eventfd per direction, created before fork
+// - kFutex:   a sequence word in the shared mapping (FUTEX_WAIT/WAKE)
+// =============================================================================
+
+#pragma once
+
+#include "adaptive_spin.h"
+#include "monotonic_clock.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/futex.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ipc {
+
+enum class RingWake { kEventfd, kFutex };
+
+inline const char *ringWakeName(RingWake w) {
+  return w == RingWake::kEventfd ? "eventfd" : "futex";
+}
+
+class ShmRing {
+public:
+  // Creates the ring in an anonymous shared mapping; it must be created
+  // before fork so both processes see the same pages and eventfds.
+  ShmRing(size_t slot_size, uint32_t capacity, RingWake wake)
+      : slot_size_(slot_size), capacity_(capacity), wake_(wake) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      throw std::runtime_error("Ring capacity must be a power of two");
+    }
+    bytes_ = sizeof(Control) + slot_size * capacity;
+    void *mem = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error(std::string("mmap of ring failed: ") +
+                               strerror(errno));
+    }
+    control_ = new (mem) Control();
+    slots_ = static_cast<char *>(mem) + sizeof(Control);
+    if (wake == RingWake::kEventfd) {
+      data_fd_ = eventfd(0, EFD_CLOEXEC);
+      space_fd_ = eventfd(0, EFD_CLOEXEC);
+      if (data_fd_ < 0 || space_fd_ < 0) {
+        int err = errno;
+        closeAll();
+        throw std::runtime_error(std::string("eventfd failed: ") +
+                                 strerror(err));
+      }
+    }
+  }
+
+  ShmRing(const ShmRing &) = delete;
+  ShmRing &operator=(const ShmRing &) = delete;
+
+  ~ShmRing() { closeAll(); }
+
+  // Copies one slot into the ring, waiting for space when it is full.
+  void send(const void *msg, const AdaptiveSpin &spin) {
+    const uint64_t head = control_->head.load(std::memory_order_relaxed);
+    if (head - control_->tail.load(std::memory_order_acquire) == capacity_) {
+      wait(control_->space, space_fd_, spin.budgetNs(), [&] {
+        return head - control_->tail.load(std::memory_order_acquire) <
+               capacity_;
+      });
+    }
+    memcpy(slot(head), msg, slot_size_);
+    control_->head.store(head + 1, std::memory_order_seq_cst);
+    notify(control_->data, data_fd_);
+  }
+
+  // Copies the oldest slot out of the ring, waiting when it is empty. Waits
+  // are recorded in `spin` so its budget follows the arrival pattern.
+  void receive(void *msg, AdaptiveSpin &spin) {
+    const uint64_t tail = control_->tail.load(std::memory_order_relaxed);
+    if (control_->head.load(std::memory_order_acquire) == tail) {
+      const uint64_t start_ns = monotonicNs();
+      const bool spun = wait(control_->data, data_fd_, spin.budgetNs(), [&] {
+        return control_->head.load(std::memory_order_acquire) != tail;
+      });
+      spin.record(monotonicNs() - start_ns, spun);
+    }
+    memcpy(msg, slot(tail), slot_size_);
+    control_->tail.store(tail + 1, std::memory_order_seq_cst);
+    notify(control_->space, space_fd_);
+  }
+
+  bool tryReceive(void *msg) {
+    const uint64_t tail = control_->tail.load(std::memory_order_relaxed);
+    if (control_->head.load(std::memory_order_acquire) == tail) {
+      return false;
+    }
+    memcpy(msg, slot(tail), slot_size_);
+    control_->tail.store(tail + 1, std::memory_order_seq_cst);
+    notify(control_->space, space_fd_);
+    return true;
+  }
+
+  RingWake wake() const { return wake_; }
+
+private:
+  // One direction's sleep state: a futex sequence word and the flag the
+  // sleeper raises before its final check
+  struct WaitState {
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> waiters{0};
+  };
+
+  struct Control {
+    alignas(64) std::atomic<uint64_t> head{0}; // Written by the sender
+    alignas(64) std::atomic<uint64_t> tail{0}; // Written by the receiver
+    alignas(64) WaitState data;                // Receiver sleeps here
+    alignas(64) WaitState space;               // Sender sleeps here
+  };
+
+  char *slot(uint64_t counter) const {
+    return slots_ + (counter & (capacity_ - 1)) * slot_size_;
+  }
+
+  // Returns true when `ready` turned true while spinning
+  template <typename Ready>
+  bool wait(WaitState &state, int fd, uint64_t spin_ns, Ready ready) {
+    if (spin_ns > 0) {
+      const uint64_t deadline = spin_ns == AdaptiveSpin::kUnbounded
+                                    ? spin_ns
+                                    : monotonicNs() + spin_ns;
+      do {
+        for (int k = 0; k < 64; ++k) {
+          if (ready()) {
+            return true;
+          }
+          cpuRelax();
+        }
+      } while (monotonicNs() < deadline);
+    }
+    while (true) {
+      const uint32_t seq = state.seq.load(std::memory_order_acquire);
+      state.waiters.store(1, std::memory_order_seq_cst);
+      if (ready()) {
+        state.waiters.store(0, std::memory_order_relaxed);
+        return false;
+      }
+      if (wake_ == RingWake::kFutex) {
+        long rc = syscall(SYS_futex, &state.seq, FUTEX_WAIT, seq, nullptr,
+                          nullptr, 0);
+        if (rc < 0 && errno != EAGAIN && errno != EINTR) {
+          throw std::runtime_error(std::string("futex wait failed: ") +
+                                   strerror(errno));
+        }
+      } else {
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+          throw std::runtime_error(std::string("eventfd read failed: ") +
+                                   strerror(errno));
+        }
+      }
+      state.waiters.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void notify(WaitState &state, int fd) {
+    if (state.waiters.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+    if (wake_ == RingWake::kFutex) {
+      state.seq.fetch_add(1, std::memory_order_release);
+      syscall(SYS_futex, &state.seq, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    } else {
+      uint64_t one = 1;
+      if (write(fd, &one, sizeof(one)) < 0) {
+        throw std::runtime_error(std::string("eventfd write failed: ") +
+                                 strerror(errno));
+      }
+    }
+  }
+
+  void closeAll() {
+    if (data_fd_ >= 0) {
+      close(data_fd_);
+    }
+    if (space_fd_ >= 0) {
+      close(space_fd_);
+    }
+    if (control_ != nullptr) {
+      munmap(control_, bytes_);
+    }
+    data_fd_ = space_fd_ = -1;
+    control_ = nullptr;
+  }
+
+  size_t slot_size_;
+  uint32_t capacity_;
+  RingWake wake_;
+  size_t bytes_ = 0;
+  Control *control_ = nullptr;
+  char *slots_ = nullptr;
+  int data_fd_ = -1;
+  int space_fd_ = -1;
+};
+
+} // namespace ipc
@@ -0,0 +1,258 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Producer-side slab allocator
+//
+// Tensors are bump-allocated out of large slabs, so many tensors share one
+// underlying allocation and one exported IPC handle. Each slab has an
+// allocation id that travels in the TensorDescriptor together with the
+// tensor's offset, which lets the consumer map the slab once and derive every
+// tensor pointer from it.
+//
+// A slab is freed once it is sealed (no more room), no local copy is still
+// reading from it, and the consumer has reported unmapping it for every
+// descriptor that referenced it through a mapping.
+// =============================================================================
+
+#pragma once
+
+#include "node_pool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace ipc {
+
+struct SlabAllocation {
+  int32_t alloc_id;
+  void *base;         // Start of the slab
+  uint64_t slab_size; // Size of the slab
+  uint64_t offset;    // Offset of the tensor inside the slab
+  void *ptr;          // base + offset
+};
+
+class SlabAllocator {
+public:
+  using AllocFn = std::function<void *(size_t)>;
+  using FreeFn = std::function<void(void *)>;
+
+  static constexpr size_t kMaxFreeSlabs = 4;
+
+  SlabAllocator(AllocFn alloc, FreeFn free, size_t slab_bytes,
+                size_t alignment = 256)
+      : alloc_(std::move(alloc)), free_(std::move(free)),
+        slab_bytes_(slab_bytes), alignment_(alignment),
+        slabs_(0, std::hash<int32_t>(), std::equal_to<int32_t>(),
+               PoolAllocator<std::pair<const int32_t, Slab>>(pool_)) {
+    // Recycling a slab must not allocate on the send path
+    free_slabs_.reserve(kMaxFreeSlabs);
+  }
+
+  SlabAllocator(const SlabAllocator &) = delete;
+  SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+  ~SlabAllocator() {
+    for (auto &kv : slabs_) {
+      free_(kv.second.base);
+    }
+    for (void *base : free_slabs_) {
+      free_(base);
+    }
+  }
+
+  // Carves `nbytes` out of the current slab, opening a new one when needed.
+  // Tensors larger than a slab get a dedicated allocation.
+  SlabAllocation allocate(size_t nbytes) {
+    size_t rounded = (nbytes + alignment_ - 1) / alignment_ * alignment_;
+    if (rounded == 0) {
+      rounded = alignment_;
+    }
+    if (rounded > slab_bytes_) {
+      Slab &slab = openSlab(rounded);
+      return carve(slab, rounded, /*seal=*/true);
+    }
+    Slab *slab = current_ >= 0 ? &slabs_.at(current_) : nullptr;
+    if (slab == nullptr || slab->used + rounded > slab->size) {
+      if (slab != nullptr) {
+        seal(*slab);
+      }
+      slab = &openSlab(slab_bytes_);
+      current_ = slab->id;
+    }
+    return carve(*slab, rounded, /*seal=*/false);
+  }
+
+  // A tensor that was delivered by copy no longer needs its source memory.
+  void releaseLocal(int32_t alloc_id) {
+    auto it = slabs_.find(alloc_id);
+    if (it == slabs_.end()) {
+      return;
+    }
+    --it->second.local;
+    maybeFree(it);
+  }
+
+  // A descriptor referencing `nbytes` of the slab through an IPC mapping
+  // was sent.
+  void markExported(int32_t alloc_id, uint64_t nbytes) {
+    auto it = slabs_.find(alloc_id);
+    if (it != slabs_.end()) {
+      --it->second.local;
+      ++it->second.remote;
+      it->second.exported += nbytes;
+      exported_bytes_ += nbytes;
+    }
+  }
+
+  // The consumer unmapped the slab after serving `count` descriptors.
+  void releaseRemote(int32_t alloc_id, uint32_t count) {
+    auto it = slabs_.find(alloc_id);
+    if (it == slabs_.end()) {
+      return;
+    }
+    it->second.remote -= count;
+    if (it->second.remote <= 0) {
+      exported_bytes_ -= it->second.exported;
+      it->second.exported = 0;
+    }
+    maybeFree(it);
+  }
+
+  // Exported handle cached per slab; returns nullptr until setHandle().
+  const uint8_t *cachedHandle(int32_t alloc_id) const {
+    auto it = slabs_.find(alloc_id);
+    return it != slabs_.end() && it->second.has_handle ? it->second.handle
+                                                       : nullptr;
+  }
+
+  void setHandle(int32_t alloc_id, const void *handle) {
+    Slab &slab = slabs_.at(alloc_id);
+    memcpy(slab.handle, handle, sizeof(slab.handle));
+    slab.has_handle = true;
+  }
+
+  size_t liveSlabs() const { return slabs_.size(); }
+
+  // Bytes held by slabs that are still in use locally or by the consumer.
+  uint64_t outstandingBytes() const { return outstanding_bytes_; }
+
+  // Bytes of exported tensors whose slab the consumer may still map.
+  uint64_t exportedBytes() const { return exported_bytes_; }
+
+private:
+  struct Slab {
+    int32_t id;
+    void *base;
+    uint64_t size;
+    uint64_t used = 0;
+    int64_t local = 0;     // Tensors allocated but not yet delivered
+    int64_t remote = 0;    // Mapped descriptors not yet released by consumer
+    uint64_t exported = 0; // Bytes of those descriptors
+    bool sealed = false;
+    bool has_handle = false;
+    uint8_t handle[64];
+  };
+
+  Slab &openSlab(size_t size) {
+    void *base = nullptr;
+    if (size == slab_bytes_ && !free_slabs_.empty()) {
+      base = free_slabs_.back();
+      free_slabs_.pop_back();
+    } else {
+      base = alloc_(size);
+    }
+    Slab slab;
+    slab.id = next_id_++;
+    slab.base = base;
+    slab.size = size;
+    outstanding_bytes_ += size;
+    return slabs_.emplace(slab.id, slab).first->second;
+  }
+
+  SlabAllocation carve(Slab &slab, size_t rounded, bool seal_after) {
+    SlabAllocation a;
+    a.alloc_id = slab.id;
+    a.base = slab.base;
+    a.slab_size = slab.size;
+    a.offset = slab.used;
+    a.ptr = static_cast<char *>(slab.base) + slab.used;
+    slab.used += rounded;
+    ++slab.local;
+    if (seal_after) {
+      slab.sealed = true;
+    }
+    return a;
+  }
+
+  void seal(Slab &slab) {
+    slab.sealed = true;
+    auto it = slabs_.find(slab.id);
+    maybeFree(it);
+  }
+
+  // Slab table nodes come from a NodePool, so opening a recycled slab does
+  // not allocate either
+  using SlabMap =
+      std::unordered_map<int32_t, Slab, std::hash<int32_t>,
+                         std::equal_to<int32_t>,
+                         PoolAllocator<std::pair<const int32_t, Slab>>>;
+
+  void maybeFree(SlabMap::iterator it) {
+    Slab &slab = it->second;
+    if (!slab.sealed || slab.local > 0 || slab.remote > 0) {
+      return;
+    }
+    outstanding_bytes_ -= slab.size;
+    // Recycled slabs get a new id, so a stale mapping of the old one can
+    // never be mistaken for the new contents
+    if (slab.size == slab_bytes_ && free_slabs_.size() < kMaxFreeSlabs &&
+        !slab.has_handle) {
+      free_slabs_.push_back(slab.base);
+    } else {
+      free_(slab.base);
+    }
+    if (current_ == slab.id) {
+      current_ = -1;
+    }
+    slabs_.erase(it);
+  }
+
+  AllocFn alloc_;
+  FreeFn free_;
+  size_t slab_bytes_;
+  size_t alignment_;
+  int32_t next_id_ = 1;
+  int32_t current_ = -1;
+  uint64_t outstanding_bytes_ = 0;
+  uint64_t exported_bytes_ = 0;
+  NodePool pool_; // Declared before the table so it outlives it
+  SlabMap slabs_;
+  std::vector<void *> free_slabs_;
+};
+
+} // namespace ipc
@@ -0,0 +1,278 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Live statistics segment
+//
+// The parent creates a small named shared memory segment before it spawns
+// the workers and passes its name in IPC_STATS_NAME. Each worker publishes
+// its counters, gauges and per-stage latency histograms into its own slot.
+// Every field has a single writer, so updates are relaxed loads and stores
+// without read-modify-write instructions; readers such as ipc-top map the
+// segment read-only and never slow the workers down.
+//
+// Latency histograms use power-of-two microsecond buckets: bucket 0 counts
+// samples below 1 us, bucket k samples in [2^(k-1), 2^k) us, and the last
+// bucket everything above.
+//
+// The consumer also publishes its tenant scheduler's counters into a bounded
+// block of tenant slots. Tenants claim slots in the order they first show
+// up; once all but the last are taken, every further tenant is summed into
+// the last one, which is labelled kOtherTenants.
+// =============================================================================
+
+#pragma once
+
+#include "monotonic_clock.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ipc {
+
+constexpr uint32_t kStatsMagic = 0x53504943; // "CIPS"
+constexpr uint32_t kStatsVersion = 2;
+constexpr int kLatencyBuckets = 24;
+constexpr int kStatsTenants = 16;
+constexpr uint32_t kOtherTenants = UINT32_MAX;
+
+enum class StatsRole { kProducer = 0, kConsumer = 1 };
+constexpr int kStatsRoles = 2;
+
+inline const char *statsRoleName(StatsRole role) {
+  return role == StatsRole::kProducer ? "producer" : "consumer";
+}
+
+// Timed stages of a tensor's trip
+enum class Stage {
+  kAdmit,       // Producer: rate limiting and watermark waits
+  kSend,        // Producer: descriptor built, staged and written
+  kQueue,       // Consumer: descriptor read until scheduled
+  kMaterialize, // Consumer: mapping or copy into a tensor
+};
+constexpr int kStages = 4;
+
+inline const char *stageName(Stage stage) {
+  switch (stage) {
+  case Stage::kAdmit:
+    return "admit";
+  case Stage::kSend:
+    return "send";
+  case Stage::kQueue:
+    return "queue";
+  case Stage::kMaterialize:
+    return "materialize";
+  }
+  return "unknown";
+}
+
+using StatCounter = std::atomic<uint64_t>;
+
+// Single-writer updates: plain relaxed stores, no locked instructions
+inline void statAdd(StatCounter &counter, uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline void statSet(StatCounter &gauge, uint64_t value) {
+  gauge.store(value, std::memory_order_relaxed);
+}
+
+inline uint64_t statGet(const StatCounter &counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+// Upper bound of latency bucket `k` in microseconds; the last one is open
+inline uint64_t latencyBucketUs(int k) { return uint64_t(1) << k; }
+
+struct LatencyHistogram {
+  StatCounter count{0};
+  StatCounter sum_ns{0};
+  StatCounter buckets[kLatencyBuckets] = {};
+
+  void record(uint64_t ns) {
+    const uint64_t us = ns / 1000;
+    int k = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    k = k < kLatencyBuckets ? k : kLatencyBuckets - 1;
+    statAdd(buckets[k], 1);
+    statAdd(sum_ns, ns);
+    statAdd(count, 1);
+  }
+};
+
+// One worker's slot. Tensors and bytes are the ones sent by the producer
+// and received by the consumer.
+struct alignas(64) WorkerStats {
+  std::atomic<int32_t> pid{0}; // 0 until the worker attached
+  StatCounter tensors{0};
+  StatCounter bytes{0};
+  StatCounter dropped{0};      // Expired tensors dropped unprocessed
+  StatCounter cache_hits{0};   // Descriptors served by a live mapping
+  StatCounter cache_misses{0}; // Descriptors that opened a mapping
+  StatCounter integrity_failures{0};
+  StatCounter in_flight{0};     // Gauge: buffers the peer may still use
+  StatCounter open_mappings{0}; // Gauge: consumer mappings held open
+  StatCounter queue_depth{0};   // Gauge: descriptors waiting to run
+  LatencyHistogram stages[kStages];
+
+  LatencyHistogram &stage(Stage s) { return stages[static_cast<int>(s)]; }
+  const LatencyHistogram &stage(Stage s) const {
+    return stages[static_cast<int>(s)];
+  }
+};
+
+// One tenant's slot, written by the consumer
+struct alignas(64) TenantStats {
+  std::atomic<uint32_t> id{0}; // Tenant id, or kOtherTenants
+  StatCounter queued{0};       // Gauge: descriptors waiting to run
+  StatCounter dispatched{0};   // Descriptors handed to the consumer
+  StatCounter dispatched_bytes{0};
+  StatCounter expired{0};       // Dispatched after their deadline
+  StatCounter quota_blocked{0}; // Turns skipped because the quota was full
+  StatCounter held_bytes{0};    // Gauge: bytes of tensors still alive
+  StatCounter held_handles{0};  // Gauge: tensors still alive
+};
+
+struct StatsLayout {
+  uint32_t magic;
+  uint32_t version;
+  int32_t parent_pid;
+  uint64_t start_ns; // CLOCK_MONOTONIC time the segment was created
+  WorkerStats workers[kStatsRoles];
+  // Slots below tenant_count are in use; a slot's id is set before the
+  // count that covers it is published
+  std::atomic<uint32_t> tenant_count{0};
+  TenantStats tenants[kStatsTenants];
+
+  WorkerStats &worker(StatsRole role) {
+    return workers[static_cast<int>(role)];
+  }
+  const WorkerStats &worker(StatsRole role) const {
+    return workers[static_cast<int>(role)];
+  }
+};
+
+enum class StatsAccess {
+  kCreate, // Parent: creates the segment and unlinks it when done
+  kWrite,  // Worker: attaches to publish
+  kRead,   // Viewer: attaches read-only
+};
+
+inline std::string defaultStatsName(int parent_pid) {
+  return "/cipc-stats-" + std::to_string(parent_pid);
+}
+
+class StatsSegment {
+public:
+  // Process-private segment for a worker started without IPC_STATS_NAME
+  StatsSegment() {
+    void *mem = mmap(nullptr, sizeof(StatsLayout), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error(std::string("mmap of stats failed: ") +
+                               strerror(errno));
+    }
+    initialize(mem);
+  }
+
+  StatsSegment(const std::string &name, StatsAccess access)
+      : name_(name), owner_(access == StatsAccess::kCreate) {
+    const int flags = access == StatsAccess::kCreate ? O_CREAT | O_EXCL | O_RDWR
+                      : access == StatsAccess::kWrite ? O_RDWR
+                                                      : O_RDONLY;
+    int fd = shm_open(name.c_str(), flags, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("shm_open of " + name +
+                               " failed: " + strerror(errno));
+    }
+    if (owner_ && ftruncate(fd, sizeof(StatsLayout)) != 0) {
+      int err = errno;
+      close(fd);
+      shm_unlink(name.c_str());
+      throw std::runtime_error(std::string("ftruncate failed: ") +
+                               strerror(err));
+    }
+    const int prot =
+        access == StatsAccess::kRead ? PROT_READ : PROT_READ | PROT_WRITE;
+    void *mem = mmap(nullptr, sizeof(StatsLayout), prot, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (mem == MAP_FAILED) {
+      if (owner_) {
+        shm_unlink(name.c_str());
+      }
+      throw std::runtime_error("mmap of " + name + " failed: " +
+                               strerror(err));
+    }
+    if (owner_) {
+      initialize(mem);
+      return;
+    }
+    layout_ = static_cast<StatsLayout *>(mem);
+    if (layout_->magic != kStatsMagic || layout_->version != kStatsVersion) {
+      munmap(mem, sizeof(StatsLayout));
+      throw std::runtime_error(name + " is not a version " +
+                               std::to_string(kStatsVersion) +
+                               " stats segment");
+    }
+  }
+
+  StatsSegment(const StatsSegment &) = delete;
+  StatsSegment &operator=(const StatsSegment &) = delete;
+
+  ~StatsSegment() {
+    munmap(layout_, sizeof(StatsLayout));
+    if (owner_) {
+      shm_unlink(name_.c_str());
+    }
+  }
+
+  const std::string &name() const { return name_; }
+  StatsLayout &layout() { return *layout_; }
+  const StatsLayout &layout() const { return *layout_; }
+  WorkerStats &worker(StatsRole role) { return layout_->worker(role); }
+
+private:
+  void initialize(void *mem) {
+    layout_ = new (mem) StatsLayout();
+    layout_->magic = kStatsMagic;
+    layout_->version = kStatsVersion;
+    layout_->parent_pid = static_cast<int32_t>(getpid());
+    layout_->start_ns = monotonicNs();
+  }
+
+  std::string name_;
+  bool owner_ = false;
+  StatsLayout *layout_ = nullptr;
+};
+
+} // namespace ipc
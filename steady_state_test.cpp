@@ -0,0 +1,278 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// Steady-state allocation test
+//
+// The sample's descriptor path is meant to stop touching the heap once it is
+// warmed up. This test drives the host-only building blocks of that path the
+// way the workers do: first a warm-up round, then the same traffic inside a
+// SteadyStateScope. The lanes round runs the workers' own send and receive
+// code from lane_io.h over real pipes, feeding the tenant scheduler and the
+// dynamic batcher as the consumer loop does; only the LibTorch calls of the
+// sample stay outside. The counting operator new from alloc_counter.h is only
+// compiled into this test (and into the sample with IPC_COUNT_ALLOCATIONS),
+// and every component must finish its steady-state round without a single
+// allocation.
+// =============================================================================
+
+#include "alloc_counter.h"
+#include "dynamic_batcher.h"
+#include "host_backend.h"
+#include "lane_io.h"
+#include "log_line.h"
+#include "node_pool.h"
+#include "slab_allocator.h"
+#include "tenant_scheduler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#ifndef IPC_DEFINE_ALLOCATION_HOOKS
+#error "steady_state_test needs IPC_DEFINE_ALLOCATION_HOOKS"
+#endif
+
+namespace {
+
+// Runs `round` once to warm up and once more inside a SteadyStateScope.
+// Returns the allocations made by the second round.
+uint64_t steadyStateRound(const std::function<void()> &round) {
+  round();
+  const uint64_t before = ipc::steadyStateAllocations();
+  {
+    ipc::SteadyStateScope steady;
+    round();
+  }
+  return ipc::steadyStateAllocations() - before;
+}
+
+// Sink for LogLine output
+class Discard : public std::streambuf {
+  int overflow(int ch) override { return traits_type::not_eof(ch); }
+};
+
+void nodePoolRound(ipc::NodePool &pool) {
+  using Map = std::map<int, int, std::less<int>,
+                       ipc::PoolAllocator<std::pair<const int, int>>>;
+  Map map{ipc::PoolAllocator<std::pair<const int, int>>(pool)};
+  for (int k = 0; k < 256; ++k) {
+    map.emplace(k * 7 % 256, k);
+  }
+  for (int k = 0; k < 256; k += 2) {
+    map.erase(k);
+  }
+}
+
+void schedulerRound(ipc::TenantScheduler<int> &scheduler) {
+  for (int k = 0; k < 64; ++k) {
+    scheduler.push(k % 3, k % 2, 4096 << (k % 4), k % 5 ? 1000 + k : 0, k);
+  }
+  int item;
+  uint32_t tenant;
+  while (scheduler.pop(item, tenant)) {
+    scheduler.release(tenant, 4096 << (item % 4));
+  }
+}
+
+void slabRound(ipc::SlabAllocator &slabs) {
+  for (int k = 0; k < 64; ++k) {
+    ipc::SlabAllocation a = slabs.allocate(256 << 10);
+    if (k % 2 == 0) {
+      slabs.releaseLocal(a.alloc_id);
+    } else {
+      slabs.markExported(a.alloc_id, 256 << 10);
+      slabs.releaseRemote(a.alloc_id, 1);
+    }
+  }
+}
+
+void stagingRound(ipc::HostStagingPool &staging) {
+  void *slots[16];
+  for (int k = 0; k < 16; ++k) {
+    slots[k] = staging.acquire(size_t(4096) << (k % 4));
+  }
+  for (void *slot : slots) {
+    staging.release(slot);
+  }
+}
+
+// Inline copies of five sizes and mapped descriptors on two lanes, read as
+// they arrive and processed with a backlog, like the consumer loop
+void laneRound(ipc::LaneWriter &writer, ipc::LaneReader &reader,
+               ipc::TenantScheduler<ipc::PendingDescriptor> &scheduler,
+               ipc::DynamicBatcher<int> &batcher, std::vector<int> &batch) {
+  ipc::PendingDescriptor pending;
+  uint32_t tenant = 0;
+  auto process = [&] {
+    if (pending.payload.size() != pending.desc.nbytes &&
+        pending.desc.transport ==
+            static_cast<uint8_t>(ipc::Transport::kStagedCopy)) {
+      throw std::runtime_error("inline payload read short");
+    }
+    reader.recycle(pending.payload);
+    scheduler.release(tenant, pending.desc.nbytes);
+    if (batcher.add(pending.desc.index, pending.read_ns, ipc::monotonicNs())) {
+      batcher.take(batch);
+    }
+  };
+  for (int k = 0; k < 64; ++k) {
+    ipc::TensorDescriptor desc{};
+    desc.index = k;
+    desc.lane = static_cast<uint8_t>(k % 2);
+    desc.tenant = k % 3;
+    desc.nbytes = size_t(1024) << (k % 5);
+    if (k % 4 != 3) {
+      desc.transport = static_cast<uint8_t>(ipc::Transport::kStagedCopy);
+      memset(writer.payload(desc.nbytes), k, desc.nbytes);
+      writer.send(desc, desc.nbytes);
+    } else {
+      desc.transport = static_cast<uint8_t>(ipc::Transport::kHostShm);
+      writer.send(desc);
+    }
+    // The doorbell shows the descriptor before it is read, and only then
+    if (reader.pending() != 1u << desc.lane) {
+      throw std::runtime_error("lane doorbell missed a descriptor");
+    }
+    reader.read(desc.lane, pending);
+    if (reader.pending() != 0) {
+      throw std::runtime_error("lane doorbell counts a read descriptor");
+    }
+    scheduler.push(pending.desc.tenant, desc.lane, pending.desc.nbytes, 0,
+                   std::move(pending));
+    if (k % 2 == 1 && scheduler.pop(pending, tenant)) {
+      process();
+    }
+  }
+  while (scheduler.pop(pending, tenant)) {
+    process();
+  }
+}
+
+void logRound(std::ostream &out) {
+  for (int k = 0; k < 64; ++k) {
+    ipc::LogLine &line = ipc::LogLine::current();
+    line.start() << "[" << k << "] Consumer received descriptor for #" << k
+                 << " from lane " << k % 2 << " " << 1.5 * k;
+    line.finish(out);
+  }
+}
+
+} // namespace
+
+int main() {
+  try {
+    int failures = 0;
+    auto check = [&](const char *name, uint64_t allocations) {
+      printf("%-18s %llu steady-state allocations\n", name,
+             static_cast<unsigned long long>(allocations));
+      failures += allocations == 0 ? 0 : 1;
+    };
+
+    // The counter itself must see allocations, or every check below is moot.
+    // A new-expression whose result is unused may be elided since C++14, so
+    // the probe calls operator new directly and hides the pointer behind a
+    // compiler barrier.
+    const uint64_t counted = steadyStateRound([] {
+      void *p = ::operator new(1);
+      asm volatile("" : : "r"(p) : "memory");
+      ::operator delete(p);
+    });
+    if (counted != 1) {
+      printf("allocation hooks counted %llu allocations, expected 1\n",
+             static_cast<unsigned long long>(counted));
+      return 1;
+    }
+
+    ipc::NodePool pool;
+    check("node_pool", steadyStateRound([&] { nodePoolRound(pool); }));
+
+    for (ipc::SchedulePolicy policy :
+         {ipc::SchedulePolicy::kFifo, ipc::SchedulePolicy::kDrr,
+          ipc::SchedulePolicy::kEdf}) {
+      ipc::TenantQuota quota;
+      quota.max_handles = 4;
+      ipc::TenantScheduler<int> scheduler(
+          policy, 64 << 10, quota,
+          ipc::LaneScheduler(ipc::LanePolicy::kWeighted, {3, 1}, 2));
+      const std::string name =
+          std::string("scheduler/") + ipc::schedulePolicyName(policy);
+      check(name.c_str(), steadyStateRound([&] { schedulerRound(scheduler); }));
+    }
+
+    ipc::SlabAllocator slabs([](size_t n) { return std::malloc(n); },
+                             [](void *p) { std::free(p); }, 2u << 20);
+    check("slab_allocator", steadyStateRound([&] { slabRound(slabs); }));
+
+    ipc::HostBackend host;
+    ipc::HostStagingPool staging(host);
+    check("staging_pool", steadyStateRound([&] { stagingRound(staging); }));
+
+    int lane_pipes[2][2];
+    for (auto &lane : lane_pipes) {
+      if (pipe(lane) != 0) {
+        throw std::runtime_error("pipe failed");
+      }
+    }
+    {
+      const int doorbell_fd = ipc::LaneDoorbell::create();
+      ipc::LaneDoorbell doorbell(doorbell_fd);
+      close(doorbell_fd);
+      ipc::LaneWriter writer({lane_pipes[0][1], lane_pipes[1][1]}, &doorbell);
+      ipc::LaneReader reader({lane_pipes[0][0], lane_pipes[1][0]}, &doorbell);
+      ipc::TenantScheduler<ipc::PendingDescriptor> scheduler(
+          ipc::SchedulePolicy::kDrr, 64 << 10, ipc::TenantQuota(),
+          ipc::LaneScheduler(ipc::LanePolicy::kStrict, {}, 2));
+      ipc::DynamicBatcher<int> batcher(8, 1000000);
+      std::vector<int> batch;
+      // The deficits carry over from one round to the next, so the tenants'
+      // queues only reach their deepest backlog after a few rounds
+      for (int round = 0; round < 8; ++round) {
+        laneRound(writer, reader, scheduler, batcher, batch);
+      }
+      check("lanes", steadyStateRound([&] {
+              laneRound(writer, reader, scheduler, batcher, batch);
+            }));
+    }
+    for (auto &lane : lane_pipes) {
+      close(lane[0]);
+      close(lane[1]);
+    }
+
+    Discard discard;
+    std::ostream out(&discard);
+    check("log_line", steadyStateRound([&] { logRound(out); }));
+
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "steady_state_test: %s\n", e.what());
+    return 2;
+  }
+}
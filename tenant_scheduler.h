@@ -0,0 +1,439 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Ready queue scheduling across tenants
+//
+// Descriptors that have been read but not yet processed wait here until the
+// consumer asks for the next one, in one of three orders:
+//  - fifo: arrival order.
+//  - drr:  deficit round robin. Each tenant has its own queue; tenants take
+//          turns, each turn adds `quantum` bytes of credit and a tenant is
+//          served while its next tensor fits its credit, so large tensors
+//          cannot crowd out small ones.
+//  - edf:  earliest deadline first, items without a deadline last.
+// Whatever the order, a tenant that already holds its quota of consumer-side
+// bytes or mappings sits out until it releases some.
+//
+// The order above applies within one priority lane. Every lane has its own
+// queues, and a pop first picks the lane with the same LaneScheduler policy
+// the lanes are read with, so an urgent descriptor never waits behind bulk
+// ones that happened to be read before it.
+//
+// peek() walks the queued items in the order pops would deliver them, so
+// work such as opening mappings can start ahead in that same order.
+//
+// Queue nodes come from a NodePool, so once every tenant has been seen and
+// the queues have reached their working size, pushing and popping no longer
+// allocate.
+// =============================================================================
+
+#pragma once
+
+#include "node_pool.h"
+#include "priority_lanes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ipc {
+
+enum class SchedulePolicy { kFifo, kDrr, kEdf };
+
+inline const char *schedulePolicyName(SchedulePolicy policy) {
+  switch (policy) {
+  case SchedulePolicy::kFifo:
+    return "fifo";
+  case SchedulePolicy::kDrr:
+    return "drr";
+  case SchedulePolicy::kEdf:
+    return "edf";
+  }
+  return "unknown";
+}
+
+inline bool schedulePolicyFromName(const std::string &name,
+                                   SchedulePolicy &policy) {
+  for (SchedulePolicy p : {SchedulePolicy::kFifo, SchedulePolicy::kDrr,
+                           SchedulePolicy::kEdf}) {
+    if (name == schedulePolicyName(p)) {
+      policy = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Zero means unlimited.
+struct TenantQuota {
+  uint64_t max_bytes = 0;
+  uint64_t max_handles = 0;
+};
+
+struct TenantCounters {
+  uint64_t queued = 0;          // Descriptors waiting to be processed
+  uint64_t delivered = 0;       // Descriptors handed to the consumer
+  uint64_t delivered_bytes = 0;
+  uint64_t quota_waits = 0;     // Turns skipped because the quota was full
+  uint64_t expired = 0;         // Delivered after their deadline
+  uint64_t held_bytes = 0;      // Bytes of delivered tensors still alive
+  uint64_t held_handles = 0;    // Delivered tensors still alive
+  uint64_t peak_held_bytes = 0;
+};
+
+template <typename T> class TenantScheduler {
+public:
+  // `lanes` picks which lane's queues the next pop is served from; a
+  // scheduler with a single lane behaves as if lanes did not exist.
+  TenantScheduler(SchedulePolicy policy, uint64_t quantum, TenantQuota quota,
+                  LaneScheduler lanes = LaneScheduler(LanePolicy::kStrict,
+                                                      {}, 1))
+      : policy_(policy), quantum_(quantum == 0 ? 1 : quantum), quota_(quota),
+        lane_scheduler_(lanes),
+        tenants_(PoolAllocator<std::pair<const uint32_t, Tenant>>(pool_)) {
+    lanes_.reserve(lane_scheduler_.lanes());
+    for (int i = 0; i < lane_scheduler_.lanes(); ++i) {
+      lanes_.emplace_back(pool_);
+    }
+  }
+
+  TenantScheduler(const TenantScheduler &) = delete;
+  TenantScheduler &operator=(const TenantScheduler &) = delete;
+
+  // Queues an item costing `cost` bytes that arrived on `lane`.
+  // `deadline_ns` only matters to EDF; zero means none.
+  void push(uint32_t tenant, int lane, uint64_t cost, uint64_t deadline_ns,
+            T item) {
+    Tenant &t = tenantFor(tenant);
+    Lane &l = lanes_[std::min(std::max(lane, 0), lane_scheduler_.lanes() - 1)];
+    ++t.counters.queued;
+    ++l.size;
+    ++size_;
+    if (policy_ != SchedulePolicy::kDrr) {
+      uint64_t key = policy_ == SchedulePolicy::kFifo ? seq_
+                     : deadline_ns == 0               ? UINT64_MAX
+                                                      : deadline_ns;
+      l.ordered.insert({key, seq_++, tenant, cost, std::move(item)});
+      return;
+    }
+    Flow &flow = l.flowFor(tenant, pool_);
+    if (flow.queue.empty()) {
+      l.active.push_back(tenant);
+    }
+    flow.queue.push_back({cost, std::move(item)});
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Pops the next item and charges its cost to the tenant's quota. Returns
+  // false when nothing is queued or every tenant with queued items is over
+  // quota. Lanes whose tenants are all over quota are passed over.
+  bool pop(T &out, uint32_t &tenant) {
+    uint32_t ready = 0;
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+      ready |= lanes_[i].size > 0 ? 1u << i : 0;
+    }
+    while (ready != 0) {
+      const int lane = lane_scheduler_.pick(ready);
+      Lane &l = lanes_[lane];
+      if (policy_ == SchedulePolicy::kDrr ? popDrr(l, out, tenant)
+                                          : popOrdered(l, out, tenant)) {
+        --l.size;
+        return true;
+      }
+      ready &= ~(1u << lane);
+    }
+    return false;
+  }
+
+  // Visits queued items in the order pops would deliver them if nothing were
+  // pushed or released in between, until `visit` returns false. DRR credit
+  // is not simulated: tenants take turns one item each. Items of tenants
+  // over quota are passed over. Does not allocate.
+  template <typename Visit> void peek(Visit visit) const {
+    LaneScheduler lanes = lane_scheduler_;
+    Cursor cursors[kMaxLanes];
+    uint32_t ready = 0;
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+      cursors[i].it = lanes_[i].ordered.begin();
+      ready |= lanes_[i].size > 0 ? 1u << i : 0;
+    }
+    while (ready != 0) {
+      const int lane = lanes.pick(ready);
+      const T *item = policy_ == SchedulePolicy::kDrr
+                          ? peekDrr(lanes_[lane], cursors[lane])
+                          : peekOrdered(lanes_[lane], cursors[lane]);
+      if (item == nullptr) {
+        ready &= ~(1u << lane);
+      } else if (!visit(*item)) {
+        return;
+      }
+    }
+  }
+
+  // Returns the quota charged for a delivered item once it is dropped.
+  void release(uint32_t tenant, uint64_t cost) {
+    TenantCounters &c = tenantFor(tenant).counters;
+    c.held_bytes -= std::min(c.held_bytes, cost);
+    c.held_handles -= c.held_handles > 0 ? 1 : 0;
+  }
+
+  void recordExpired(uint32_t tenant) {
+    ++tenantFor(tenant).counters.expired;
+  }
+
+  const TenantCounters &counters(uint32_t tenant) {
+    return tenantFor(tenant).counters;
+  }
+
+  // Visits every tenant seen so far with its counters, in id order. Does not
+  // allocate.
+  template <typename Visit> void forEachTenant(Visit visit) const {
+    for (const auto &kv : tenants_) {
+      visit(kv.first, kv.second.counters);
+    }
+  }
+
+  std::string summary() const {
+    std::string out;
+    for (const auto &kv : tenants_) {
+      const TenantCounters &c = kv.second.counters;
+      char line[256];
+      snprintf(line, sizeof(line),
+               "tenant %u: %llu tensors, %llu bytes, %llu expired, "
+               "%llu quota waits, peak %llu bytes held\n",
+               kv.first, static_cast<unsigned long long>(c.delivered),
+               static_cast<unsigned long long>(c.delivered_bytes),
+               static_cast<unsigned long long>(c.expired),
+               static_cast<unsigned long long>(c.quota_waits),
+               static_cast<unsigned long long>(c.peak_held_bytes));
+      out += line;
+    }
+    return out;
+  }
+
+private:
+  struct Entry {
+    uint64_t cost;
+    T item;
+  };
+
+  // Queued item in FIFO or EDF order
+  struct Ordered {
+    uint64_t key;
+    uint64_t seq;
+    uint32_t tenant;
+    uint64_t cost;
+    mutable T item;
+
+    bool operator<(const Ordered &other) const {
+      return key != other.key ? key < other.key : seq < other.seq;
+    }
+  };
+
+  struct Tenant {
+    TenantCounters counters;
+  };
+
+  // One tenant's DRR queue within a lane
+  struct Flow {
+    explicit Flow(NodePool &pool) : queue(PoolAllocator<Entry>(pool)) {}
+
+    std::deque<Entry, PoolAllocator<Entry>> queue;
+    uint64_t deficit = 0;
+    bool granted = false; // Quantum already added for the current turn
+  };
+
+  using TenantMap =
+      std::map<uint32_t, Tenant, std::less<uint32_t>,
+               PoolAllocator<std::pair<const uint32_t, Tenant>>>;
+  using FlowMap = std::map<uint32_t, Flow, std::less<uint32_t>,
+                           PoolAllocator<std::pair<const uint32_t, Flow>>>;
+  using ActiveQueue = std::deque<uint32_t, PoolAllocator<uint32_t>>;
+  using OrderedSet =
+      std::set<Ordered, std::less<Ordered>, PoolAllocator<Ordered>>;
+
+  // Queues of one priority lane
+  struct Lane {
+    explicit Lane(NodePool &pool)
+        : flows(PoolAllocator<std::pair<const uint32_t, Flow>>(pool)),
+          active(PoolAllocator<uint32_t>(pool)),
+          ordered(PoolAllocator<Ordered>(pool)) {}
+
+    Flow &flowFor(uint32_t tenant, NodePool &pool) {
+      return flows.try_emplace(tenant, pool).first->second;
+    }
+
+    FlowMap flows;
+    ActiveQueue active; // DRR tenants with queued items, in turn order
+    OrderedSet ordered; // FIFO and EDF queue
+    size_t size = 0;
+  };
+
+  // Where peek() has got to within one lane
+  struct Cursor {
+    typename OrderedSet::const_iterator it; // FIFO and EDF
+    size_t turn = 0;    // DRR: next tenant in `active`
+    size_t round = 0;   // DRR: position within each tenant's queue
+    bool found = false; // DRR: some tenant had an item this round
+  };
+
+  Tenant &tenantFor(uint32_t id) { return tenants_[id]; }
+
+  // Every tenant with queued items has been seen by push()
+  const TenantCounters &seenCounters(uint32_t id) const {
+    return tenants_.find(id)->second.counters;
+  }
+
+  const T *peekOrdered(const Lane &l, Cursor &c) const {
+    for (; c.it != l.ordered.end(); ++c.it) {
+      if (withinQuota(seenCounters(c.it->tenant), c.it->cost)) {
+        return &(c.it++)->item;
+      }
+    }
+    return nullptr;
+  }
+
+  const T *peekDrr(const Lane &l, Cursor &c) const {
+    while (!l.active.empty()) {
+      if (c.turn == l.active.size()) {
+        if (!c.found) {
+          return nullptr;
+        }
+        c.turn = 0;
+        ++c.round;
+        c.found = false;
+      }
+      const uint32_t id = l.active[c.turn++];
+      const Flow &flow = l.flows.find(id)->second;
+      if (c.round < flow.queue.size() &&
+          withinQuota(seenCounters(id), flow.queue.front().cost)) {
+        c.found = true;
+        return &flow.queue[c.round].item;
+      }
+    }
+    return nullptr;
+  }
+
+  bool popDrr(Lane &l, T &out, uint32_t &tenant) {
+    size_t blocked = 0;
+    while (!l.active.empty() && blocked < l.active.size()) {
+      const uint32_t id = l.active.front();
+      Flow &flow = l.flowFor(id, pool_);
+      TenantCounters &c = tenantFor(id).counters;
+      Entry &next = flow.queue.front();
+      if (!withinQuota(c, next.cost)) {
+        ++c.quota_waits;
+        flow.granted = false;
+        rotate(l.active);
+        ++blocked;
+        continue;
+      }
+      blocked = 0;
+      if (!flow.granted) {
+        flow.deficit += quantum_;
+        flow.granted = true;
+      }
+      if (next.cost > flow.deficit) {
+        // Not enough credit this turn; it carries over to the next one
+        flow.granted = false;
+        rotate(l.active);
+        continue;
+      }
+      flow.deficit -= next.cost;
+      out = std::move(next.item);
+      tenant = id;
+      deliver(c, next.cost);
+      flow.queue.pop_front();
+      if (flow.queue.empty()) {
+        // Idle tenants do not bank credit
+        flow.deficit = 0;
+        flow.granted = false;
+        l.active.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool popOrdered(Lane &l, T &out, uint32_t &tenant) {
+    for (auto it = l.ordered.begin(); it != l.ordered.end(); ++it) {
+      TenantCounters &c = tenantFor(it->tenant).counters;
+      if (!withinQuota(c, it->cost)) {
+        ++c.quota_waits;
+        continue;
+      }
+      out = std::move(it->item);
+      tenant = it->tenant;
+      deliver(c, it->cost);
+      l.ordered.erase(it);
+      return true;
+    }
+    return false;
+  }
+
+  void deliver(TenantCounters &c, uint64_t cost) {
+    --c.queued;
+    ++c.delivered;
+    c.delivered_bytes += cost;
+    c.held_bytes += cost;
+    ++c.held_handles;
+    c.peak_held_bytes = std::max(c.peak_held_bytes, c.held_bytes);
+    --size_;
+  }
+
+  // A tenant holding nothing may always take one item, however large, so a
+  // quota smaller than a single tensor cannot wedge it.
+  bool withinQuota(const TenantCounters &c, uint64_t cost) const {
+    if (c.held_handles == 0) {
+      return true;
+    }
+    return (quota_.max_bytes == 0 || c.held_bytes + cost <= quota_.max_bytes) &&
+           (quota_.max_handles == 0 || c.held_handles < quota_.max_handles);
+  }
+
+  static void rotate(ActiveQueue &active) {
+    active.push_back(active.front());
+    active.pop_front();
+  }
+
+  SchedulePolicy policy_;
+  uint64_t quantum_;
+  TenantQuota quota_;
+  LaneScheduler lane_scheduler_;
+  NodePool pool_; // Declared before the containers so it outlives them
+  TenantMap tenants_;
+  std::vector<Lane> lanes_;
+  uint64_t seq_ = 0;
+  size_t size_ = 0;
+};
+
+} // namespace ipc
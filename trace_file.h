@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Descriptor traces
+//
+// A trace is a small header followed by one fixed-size record per tensor
+// descriptor the producer sent, with the time it was sent. Records keep what
+// shapes the traffic (size, element type, tenant, lane, deadline budget and
+// delivery path) but not the handles or the transport, so a trace recorded on
+// a GPU box can be replayed against the host backend, or against a different
+// transport, at any speed. A replay sends each tensor on its recorded lane
+// and, where the replaying run allows it, on its recorded path.
+// =============================================================================
+
+#pragma once
+
+#include "load_generator.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ipc {
+
+constexpr uint32_t kTraceMagic = 0x54435049; // "IPCT"
+constexpr uint32_t kTraceVersion = 1;
+
+struct TraceHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+struct TraceRecord {
+  uint64_t send_ns;     // Offset from the start of the recording
+  uint64_t nbytes;
+  uint32_t deadline_us; // Deadline budget after creation, 0 when none
+  uint32_t tenant;
+  int32_t index;
+  uint8_t dtype;        // DType
+  uint8_t lane;
+  uint8_t path;         // DeliveryPath the recording producer chose
+  uint8_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord layout changed");
+static_assert(std::is_trivially_copyable<TraceRecord>::value,
+              "TraceRecord is written as raw bytes");
+
+class TraceWriter {
+public:
+  explicit TraceWriter(const std::string &path)
+      : file_(fopen(path.c_str(), "wb")) {
+    if (file_ == nullptr) {
+      throw std::runtime_error("Cannot create trace " + path + ": " +
+                               strerror(errno));
+    }
+    // Records are appended on the send path; keep them in a large buffer
+    setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    TraceHeader header = {kTraceMagic, kTraceVersion, sizeof(TraceRecord), 0};
+    write(&header, sizeof(header));
+  }
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  ~TraceWriter() { fclose(file_); }
+
+  void append(const TraceRecord &record) { write(&record, sizeof(record)); }
+
+  uint64_t records() const { return records_; }
+
+private:
+  void write(const void *data, size_t size) {
+    if (fwrite(data, size, 1, file_) != 1) {
+      throw std::runtime_error("Failed to write trace: " +
+                               std::string(strerror(errno)));
+    }
+    records_ += size == sizeof(TraceRecord) ? 1 : 0;
+  }
+
+  FILE *file_;
+  uint64_t records_ = 0;
+};
+
+inline std::vector<TraceRecord> readTrace(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    throw std::runtime_error("Cannot open trace " + path + ": " +
+                             strerror(errno));
+  }
+  TraceHeader header;
+  std::vector<TraceRecord> records;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               header.magic == kTraceMagic &&
+               header.version == kTraceVersion &&
+               header.record_size == sizeof(TraceRecord);
+  TraceRecord record;
+  while (valid && fread(&record, sizeof(record), 1, file) == 1) {
+    records.push_back(record);
+  }
+  fclose(file);
+  if (!valid) {
+    throw std::runtime_error("Not a descriptor trace: " + path);
+  }
+  return records;
+}
+
+// Replays a recorded trace as a load source. `speed` scales time: 2 sends
+// twice as fast as recorded, 0 sends back to back.
+class TraceReplay {
+public:
+  TraceReplay(const std::string &path, double speed)
+      : records_(readTrace(path)), speed_(speed) {}
+
+  bool next(LoadItem &item) {
+    if (pos_ == records_.size()) {
+      return false;
+    }
+    const TraceRecord &r = records_[pos_++];
+    item.arrival_ns = speed_ > 0 ? static_cast<uint64_t>(r.send_ns / speed_)
+                                 : 0;
+    item.nbytes = r.nbytes;
+    item.dtype = static_cast<DType>(r.dtype);
+    item.tenant = static_cast<int64_t>(r.tenant);
+    item.deadline_ns = static_cast<uint64_t>(r.deadline_us) * 1000;
+    item.lane = r.lane;
+    item.path = r.path;
+    return true;
+  }
+
+  size_t size() const { return records_.size(); }
+
+private:
+  std::vector<TraceRecord> records_;
+  double speed_;
+  size_t pos_ = 0;
+};
+
+} // namespace ipc
@@ -0,0 +1,429 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Descriptor transport microbenchmark
+//
+// Measures how fast the 68-byte index + IPC handle message moves between two
+// processes over each candidate transport:
+// - pipe:          a pair of anonymous pipes, as the tensor pipe uses today
+// - seqpacket:     an AF_UNIX SOCK_SEQPACKET socketpair
+// - eventfd_ring:  a shared memory ring that always sleeps on an eventfd
+// - futex_ring:    a shared memory ring that spins for an adaptive budget
+//                  before it sleeps on a futex (--spin busy_poll never
+//                  sleeps, --spin block never spins)
+//
+// Every transport runs unpinned and with the two processes pinned to two
+// CPUs (the same CPU when only one is available). Ping-pong reports the
+// median and p99 round trip; one-way throughput reports messages per second
+// for a burst the receiver acknowledges once at the end.
+// =============================================================================
+
+#include "ipc_protocol.h"
+#include "shm_ring.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// What the producer sends per tensor on the pre-slab protocol
+struct HandleMessage {
+  int32_t index;
+  uint8_t handle[64];
+};
+static_assert(sizeof(HandleMessage) == 68, "HandleMessage must be 68 bytes");
+
+constexpr int32_t kStopIndex = -1;
+
+// A bidirectional link created before fork; side 0 is the parent, side 1
+// the child.
+class Link {
+public:
+  virtual ~Link() = default;
+  virtual void send(int side, const HandleMessage &msg) = 0;
+  virtual void receive(int side, HandleMessage &msg) = 0;
+  // Drops the other side's file descriptors after fork
+  virtual void keepSide(int side) { (void)side; }
+};
+
+class PipeLink : public Link {
+public:
+  PipeLink() {
+    if (pipe(down_) != 0 || pipe(up_) != 0) {
+      throw std::runtime_error(std::string("pipe failed: ") +
+                               strerror(errno));
+    }
+  }
+  ~PipeLink() override {
+    for (int fd : {down_[0], down_[1], up_[0], up_[1]}) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+  void send(int side, const HandleMessage &msg) override {
+    ipc::writeExact(side == 0 ? down_[1] : up_[1], &msg, sizeof(msg),
+                    "message");
+  }
+  void receive(int side, HandleMessage &msg) override {
+    ipc::readExact(side == 0 ? up_[0] : down_[0], &msg, sizeof(msg),
+                   "message");
+  }
+  void keepSide(int side) override {
+    int &a = side == 0 ? down_[0] : down_[1];
+    int &b = side == 0 ? up_[1] : up_[0];
+    close(a);
+    close(b);
+    a = b = -1;
+  }
+
+private:
+  int down_[2] = {-1, -1}; // Parent to child
+  int up_[2] = {-1, -1};   // Child to parent
+};
+
+class SeqpacketLink : public Link {
+public:
+  SeqpacketLink() {
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds_) != 0) {
+      throw std::runtime_error(std::string("socketpair failed: ") +
+                               strerror(errno));
+    }
+  }
+  ~SeqpacketLink() override {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+  void send(int side, const HandleMessage &msg) override {
+    ssize_t n;
+    do {
+      n = ::send(fds_[side], &msg, sizeof(msg), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != static_cast<ssize_t>(sizeof(msg))) {
+      throw std::runtime_error(std::string("send failed: ") +
+                               strerror(errno));
+    }
+  }
+  void receive(int side, HandleMessage &msg) override {
+    ssize_t n;
+    do {
+      n = recv(fds_[side], &msg, sizeof(msg), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n != static_cast<ssize_t>(sizeof(msg))) {
+      throw std::runtime_error(std::string("recv failed: ") +
+                               (n == 0 ? "peer closed" : strerror(errno)));
+    }
+  }
+  void keepSide(int side) override {
+    close(fds_[1 - side]);
+    fds_[1 - side] = -1;
+  }
+
+private:
+  int fds_[2] = {-1, -1};
+};
+
+// Two rings, one per direction, waiting as `spin` says
+class RingLink : public Link {
+public:
+  RingLink(ipc::RingWake wake, const ipc::AdaptiveSpin &spin)
+      : down_(sizeof(HandleMessage), 256, wake),
+        up_(sizeof(HandleMessage), 256, wake), spin_(spin) {}
+
+  void send(int side, const HandleMessage &msg) override {
+    (side == 0 ? down_ : up_).send(&msg, spin_);
+  }
+  void receive(int side, HandleMessage &msg) override {
+    (side == 0 ? up_ : down_).receive(&msg, spin_);
+  }
+
+private:
+  ipc::ShmRing down_;
+  ipc::ShmRing up_;
+  ipc::AdaptiveSpin spin_;
+};
+
+struct Scenario {
+  std::string transport;
+  bool pinned;
+
+  std::string name() const {
+    return transport + (pinned ? "/pinned" : "/unpinned");
+  }
+};
+
+struct Result {
+  double median_ns = 0;
+  double p99_ns = 0;
+  double msgs_per_s = 0;
+};
+
+struct Options {
+  std::string json;
+  std::string filter;
+  int iterations = 50000;
+  int messages = 500000;
+  ipc::SpinMode spin = ipc::SpinMode::kAdaptive;
+  uint64_t spin_ns = 50000;
+};
+
+std::unique_ptr<Link> makeLink(const std::string &transport,
+                               const Options &options) {
+  if (transport == "pipe") {
+    return std::unique_ptr<Link>(new PipeLink());
+  }
+  if (transport == "seqpacket") {
+    return std::unique_ptr<Link>(new SeqpacketLink());
+  }
+  if (transport == "eventfd_ring") {
+    return std::unique_ptr<Link>(new RingLink(
+        ipc::RingWake::kEventfd, ipc::AdaptiveSpin(ipc::SpinMode::kBlock, 0)));
+  }
+  return std::unique_ptr<Link>(
+      new RingLink(ipc::RingWake::kFutex,
+                   ipc::AdaptiveSpin(options.spin, options.spin_ns)));
+}
+
+// First two CPUs this process may run on; both are the same CPU on a
+// single-CPU machine.
+void pinningCpus(int &parent_cpu, int &child_cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    throw std::runtime_error(std::string("sched_getaffinity failed: ") +
+                             strerror(errno));
+  }
+  parent_cpu = child_cpu = -1;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &set)) {
+      continue;
+    }
+    if (parent_cpu < 0) {
+      parent_cpu = child_cpu = cpu;
+    } else {
+      child_cpu = cpu;
+      break;
+    }
+  }
+}
+
+void pinTo(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    throw std::runtime_error("sched_setaffinity to CPU " +
+                             std::to_string(cpu) + " failed: " +
+                             strerror(errno));
+  }
+}
+
+double percentile(std::vector<uint64_t> samples, double q) {
+  std::sort(samples.begin(), samples.end());
+  size_t k = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+  return static_cast<double>(samples[k]);
+}
+
+// Child side: echoes ping-pong messages until the stop message, then
+// acknowledges one burst of `messages` with a single reply.
+void runEchoer(Link &link, int messages) {
+  HandleMessage msg{};
+  while (true) {
+    link.receive(1, msg);
+    if (msg.index == kStopIndex) {
+      break;
+    }
+    link.send(1, msg);
+  }
+  for (int k = 0; k < messages; ++k) {
+    link.receive(1, msg);
+  }
+  link.send(1, msg);
+}
+
+Result runScenario(const Scenario &s, const Options &options) {
+  std::unique_ptr<Link> link = makeLink(s.transport, options);
+  int parent_cpu = -1, child_cpu = -1;
+  cpu_set_t saved;
+  CPU_ZERO(&saved);
+  if (s.pinned) {
+    pinningCpus(parent_cpu, child_cpu);
+    sched_getaffinity(0, sizeof(saved), &saved);
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+  }
+  if (pid == 0) {
+    int status = 0;
+    try {
+      link->keepSide(1);
+      if (s.pinned) {
+        pinTo(child_cpu);
+      }
+      runEchoer(*link, options.messages);
+    } catch (const std::exception &e) {
+      fprintf(stderr, "echoer: %s\n", e.what());
+      status = 1;
+    }
+    _exit(status);
+  }
+  link->keepSide(0);
+  if (s.pinned) {
+    pinTo(parent_cpu);
+  }
+
+  Result result;
+  HandleMessage msg{};
+  memset(msg.handle, 0xab, sizeof(msg.handle));
+  const int warmup = options.iterations / 10;
+  std::vector<uint64_t> samples;
+  samples.reserve(options.iterations);
+  for (int i = 0; i < warmup + options.iterations; ++i) {
+    msg.index = i;
+    const uint64_t start_ns = ipc::monotonicNs();
+    link->send(0, msg);
+    link->receive(0, msg);
+    if (i >= warmup) {
+      samples.push_back(ipc::monotonicNs() - start_ns);
+    }
+  }
+  msg.index = kStopIndex;
+  link->send(0, msg);
+
+  const uint64_t start_ns = ipc::monotonicNs();
+  for (int k = 0; k < options.messages; ++k) {
+    msg.index = k;
+    link->send(0, msg);
+  }
+  link->receive(0, msg);
+  const uint64_t elapsed_ns = ipc::monotonicNs() - start_ns;
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (s.pinned) {
+    sched_setaffinity(0, sizeof(saved), &saved);
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    throw std::runtime_error("Echoer failed in " + s.name());
+  }
+  result.median_ns = percentile(samples, 0.5);
+  result.p99_ns = percentile(samples, 0.99);
+  result.msgs_per_s =
+      options.messages * 1e9 / std::max<uint64_t>(1, elapsed_ns);
+  return result;
+}
+
+std::string toJson(const std::vector<std::pair<std::string, Result>> &rows) {
+  std::ostringstream out;
+  out << "{\n  \"scenarios\": [\n";
+  for (size_t k = 0; k < rows.size(); ++k) {
+    const Result &r = rows[k].second;
+    out << "    {\"name\": \"" << rows[k].first << "\", \"median_ns\": "
+        << static_cast<uint64_t>(r.median_ns)
+        << ", \"p99_ns\": " << static_cast<uint64_t>(r.p99_ns)
+        << ", \"msgs_per_s\": " << static_cast<uint64_t>(r.msgs_per_s) << "}"
+        << (k + 1 < rows.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+Options parseOptions(int argc, char *argv[]) {
+  Options o;
+  for (int k = 1; k < argc; ++k) {
+    std::string arg = argv[k];
+    if (k + 1 >= argc) {
+      throw std::runtime_error("Missing value for " + arg);
+    }
+    std::string value = argv[++k];
+    if (arg == "--json") {
+      o.json = value;
+    } else if (arg == "--filter") {
+      o.filter = value;
+    } else if (arg == "--iterations") {
+      o.iterations = std::max(1, atoi(value.c_str()));
+    } else if (arg == "--messages") {
+      o.messages = std::max(1, atoi(value.c_str()));
+    } else if (arg == "--spin") {
+      if (!ipc::spinModeFromName(value, o.spin)) {
+        throw std::runtime_error("Unknown spin mode " + value);
+      }
+    } else if (arg == "--spin-us") {
+      o.spin_ns = strtoull(value.c_str(), nullptr, 10) * 1000;
+    } else {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+  }
+  return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  try {
+    Options options = parseOptions(argc, argv);
+    std::vector<std::pair<std::string, Result>> rows;
+    printf("%-24s %12s %12s %14s\n", "transport", "rtt median", "rtt p99",
+           "one-way");
+    for (const char *transport :
+         {"pipe", "seqpacket", "eventfd_ring", "futex_ring"}) {
+      for (bool pinned : {false, true}) {
+        Scenario s{transport, pinned};
+        if (s.name().find(options.filter) == std::string::npos) {
+          continue;
+        }
+        Result r = runScenario(s, options);
+        rows.emplace_back(s.name(), r);
+        printf("%-24s %9.0f ns %9.0f ns %9.2f M/s\n", s.name().c_str(),
+               r.median_ns, r.p99_ns, r.msgs_per_s / 1e6);
+        fflush(stdout);
+      }
+    }
+    if (!options.json.empty()) {
+      std::ofstream out(options.json);
+      out << toJson(rows);
+      if (!out) {
+        throw std::runtime_error("Cannot write " + options.json);
+      }
+    }
+    return 0;
+  } catch (const std::exception &e) {
+    fprintf(stderr, "transport_bench: %s\n", e.what());
+    return 2;
+  }
+}
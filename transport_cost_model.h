@@ -0,0 +1,249 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Online cost model for per-tensor delivery path selection
+//
+// Every tensor can reach the consumer in one of three ways:
+// - Inline copy:     payload bytes follow the descriptor on the tensor pipe
+// - Pooled staging:  payload is copied into a reusable shared memory slot
+// - IPC mapping:     the consumer maps the producer's allocation directly
+//
+// Which one is cheapest depends on the tensor size and on the machine, so the
+// model learns it online. Observed costs are kept per path and per power-of-two
+// size bucket as exponentially weighted moving averages, split into the
+// producer side (export latency or copy-in) and the consumer side (open
+// latency or copy-out, reported back over the feedback channel). A small,
+// periodic amount of exploration keeps the estimates fresh when the size
+// distribution of the workload shifts.
+//
+// An IPC mapping costs the consumer a handle open only when the mapping is
+// not cached yet. Its consumer cost is therefore kept separately for cache
+// hits and misses and blended by the bucket's observed hit rate.
+// =============================================================================
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace ipc {
+
+enum class DeliveryPath : uint8_t {
+  kInlineCopy = 0,
+  kPooledStaging = 1,
+  kIpcMapping = 2,
+};
+
+constexpr int kNumDeliveryPaths = 3;
+
+inline const char *deliveryPathName(DeliveryPath p) {
+  switch (p) {
+  case DeliveryPath::kInlineCopy:
+    return "inline_copy";
+  case DeliveryPath::kPooledStaging:
+    return "pooled_staging";
+  case DeliveryPath::kIpcMapping:
+    return "ipc_mapping";
+  }
+  return "unknown";
+}
+
+constexpr uint32_t deliveryPathBit(DeliveryPath p) {
+  return 1u << static_cast<uint32_t>(p);
+}
+
+class TransportCostModel {
+public:
+  enum class Side { kProducer, kConsumer };
+
+  static constexpr int kNumBuckets = 48;
+  static constexpr double kAlpha = 0.2;
+  // One decision in this many per bucket re-samples the least recently
+  // measured path.
+  static constexpr uint32_t kExploreInterval = 16;
+
+  explicit TransportCostModel(uint32_t allowed_paths)
+      : allowed_(allowed_paths) {}
+
+  static int bucketFor(uint64_t nbytes) {
+    int b = 0;
+    while (nbytes > 1 && b < kNumBuckets - 1) {
+      nbytes >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+  uint32_t allowedPaths() const { return allowed_; }
+
+  // Picks the path with the lowest predicted cost for a tensor of this size.
+  DeliveryPath choose(uint64_t nbytes) {
+    Bucket &bucket = buckets_[bucketFor(nbytes)];
+    ++bucket.decisions;
+    ++clock_;
+
+    // Unmeasured paths are tried first, then the stalest one periodically.
+    // Consumer costs arrive asynchronously and count as zero until then.
+    int stalest = -1;
+    for (int p = 0; p < kNumDeliveryPaths; ++p) {
+      if (!isAllowed(p)) {
+        continue;
+      }
+      const Cell &cell = bucket.cells[p];
+      if (cell.producer.samples == 0) {
+        return recordChoice(bucket, p);
+      }
+      if (stalest < 0 || cell.last_chosen < bucket.cells[stalest].last_chosen) {
+        stalest = p;
+      }
+    }
+    if (stalest >= 0 && bucket.decisions % kExploreInterval == 0) {
+      return recordChoice(bucket, stalest);
+    }
+
+    int best = -1;
+    double best_cost = 0;
+    for (int p = 0; p < kNumDeliveryPaths; ++p) {
+      if (!isAllowed(p)) {
+        continue;
+      }
+      double cost = bucket.cells[p].predictedNs();
+      if (best < 0 || cost < best_cost) {
+        best = p;
+        best_cost = cost;
+      }
+    }
+    if (best < 0) {
+      return DeliveryPath::kInlineCopy;
+    }
+    return recordChoice(bucket, best);
+  }
+
+  void record(DeliveryPath path, Side side, uint64_t nbytes, uint64_t ns) {
+    Cell &cell = buckets_[bucketFor(nbytes)].cells[static_cast<int>(path)];
+    (side == Side::kProducer ? cell.producer : cell.consumer).add(ns);
+    Totals &t = totals_[static_cast<int>(path)];
+    (side == Side::kProducer ? t.producer_ns : t.consumer_ns) += ns;
+    if (side == Side::kProducer) {
+      t.bytes += nbytes;
+      ++t.tensors;
+    }
+  }
+
+  // Consumer cost of an IPC mapping lookup that did or did not find the
+  // mapping cached; recorded in addition to record().
+  void recordCacheLookup(uint64_t nbytes, uint64_t ns, bool hit) {
+    Cell &cell = buckets_[bucketFor(nbytes)]
+                     .cells[static_cast<int>(DeliveryPath::kIpcMapping)];
+    (hit ? cell.hit : cell.miss).add(ns);
+    cell.hit_rate = cell.hit_rate * (1 - kAlpha) + (hit ? kAlpha : 0.0);
+    hit_rate_ = hit_rate_ * (1 - kAlpha) + (hit ? kAlpha : 0.0);
+    ++lookups_;
+  }
+
+  double cacheHitRate() const { return lookups_ == 0 ? 0.0 : hit_rate_; }
+
+  // One line per path that carried traffic, for end-of-run logging.
+  std::string summary() const {
+    std::string out;
+    for (int p = 0; p < kNumDeliveryPaths; ++p) {
+      const Totals &t = totals_[p];
+      if (t.tensors == 0) {
+        continue;
+      }
+      double total_ns = static_cast<double>(t.producer_ns + t.consumer_ns);
+      char line[256];
+      snprintf(line, sizeof(line),
+               "%s: %llu tensors, %llu bytes, producer %.0f ns/tensor, "
+               "consumer %.0f ns/tensor, %.3f GB/s\n",
+               deliveryPathName(static_cast<DeliveryPath>(p)),
+               static_cast<unsigned long long>(t.tensors),
+               static_cast<unsigned long long>(t.bytes),
+               static_cast<double>(t.producer_ns) / t.tensors,
+               static_cast<double>(t.consumer_ns) / t.tensors,
+               total_ns > 0 ? static_cast<double>(t.bytes) / total_ns : 0.0);
+      out += line;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "cache hit rate: %.3f\n", cacheHitRate());
+    return out + line;
+  }
+
+private:
+  struct Ewma {
+    double value = 0;
+    uint64_t samples = 0;
+    void add(uint64_t ns) {
+      value = samples == 0 ? static_cast<double>(ns)
+                           : value * (1 - kAlpha) + kAlpha * ns;
+      ++samples;
+    }
+  };
+
+  struct Cell {
+    Ewma producer;
+    Ewma consumer;
+    Ewma hit;  // Consumer cost of cache hits (IPC mapping only)
+    Ewma miss; // Consumer cost of cache misses (IPC mapping only)
+    double hit_rate = 0;
+    uint64_t last_chosen = 0;
+    double predictedNs() const { return producer.value + consumerNs(); }
+    double consumerNs() const {
+      if (hit.samples == 0 || miss.samples == 0) {
+        return consumer.value;
+      }
+      return hit_rate * hit.value + (1 - hit_rate) * miss.value;
+    }
+  };
+
+  struct Bucket {
+    std::array<Cell, kNumDeliveryPaths> cells;
+    uint32_t decisions = 0;
+  };
+
+  struct Totals {
+    uint64_t tensors = 0;
+    uint64_t bytes = 0;
+    uint64_t producer_ns = 0;
+    uint64_t consumer_ns = 0;
+  };
+
+  bool isAllowed(int p) const { return allowed_ & (1u << p); }
+
+  DeliveryPath recordChoice(Bucket &bucket, int p) {
+    bucket.cells[p].last_chosen = clock_;
+    return static_cast<DeliveryPath>(p);
+  }
+
+  uint32_t allowed_;
+  uint64_t clock_ = 0;
+  double hit_rate_ = 0;
+  uint64_t lookups_ = 0;
+  std::array<Bucket, kNumBuckets> buckets_;
+  std::array<Totals, kNumDeliveryPaths> totals_;
+};
+
+} // namespace ipc
@@ -0,0 +1,97 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// =============================================================================
+// USDT static probes
+//
+// Probes on the handle-transfer path, for attaching bpftrace, perf or
+// SystemTap to a running process without restarting it:
+//
+//   cipc:alloc    index, nbytes, alloc_id     producer carved a tensor
+//   cipc:export   index, slab bytes, fp       producer exported a slab handle
+//   cipc:send     index, nbytes, fp           producer wrote a descriptor
+//   cipc:receive  index, nbytes, fp           consumer read a descriptor
+//   cipc:open     index, mapping bytes, fp    consumer opened a mapping
+//   cipc:wrap     index, nbytes, fp           consumer built the tensor
+//   cipc:close    alloc_id, mapping bytes, fp consumer unmapped a mapping
+//
+// `fp` is the handle fingerprint, hashHandleBytes() of the 64-byte handle,
+// and 0 for tensors delivered by copy. The probes fire the same way on the
+// CUDA and the host backend.
+//
+// A probe site is a nop plus a test of its semaphore, which tracers raise
+// while attached; arguments such as the fingerprint are only computed then.
+// Without <sys/sdt.h> (systemtap-sdt-dev), or with IPC_NO_USDT defined, the
+// probes compile to nothing. The one translation unit that includes this
+// header with IPC_DEFINE_PROBE_SEMAPHORES defined owns the semaphores.
+//
+//   bpftrace -e 'usdt:./sample:cipc:open { printf("%d %x\n", arg0, arg2); }'
+// =============================================================================
+
+#pragma once
+
+#if !defined(IPC_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define IPC_HAVE_USDT 1
+#endif
+#endif
+
+#if defined(IPC_HAVE_USDT)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+// Semaphores live in .probes under the names sys/sdt.h expects
+#define IPC_PROBE_SEMAPHORE(name) cipc_##name##_semaphore
+#if defined(IPC_DEFINE_PROBE_SEMAPHORES)
+#define IPC_DECLARE_PROBE(name)                                                \
+  volatile unsigned short IPC_PROBE_SEMAPHORE(name)                            \
+      __attribute__((unused, section(".probes"))) = 0
+#else
+#define IPC_DECLARE_PROBE(name)                                                \
+  extern volatile unsigned short IPC_PROBE_SEMAPHORE(name)
+#endif
+
+IPC_DECLARE_PROBE(alloc);
+IPC_DECLARE_PROBE(export);
+IPC_DECLARE_PROBE(send);
+IPC_DECLARE_PROBE(receive);
+IPC_DECLARE_PROBE(open);
+IPC_DECLARE_PROBE(wrap);
+IPC_DECLARE_PROBE(close);
+
+#define IPC_PROBE(name, a, b, c)                                               \
+  do {                                                                         \
+    if (__builtin_expect(IPC_PROBE_SEMAPHORE(name) != 0, 0)) {                 \
+      DTRACE_PROBE3(cipc, name, a, b, c);                                      \
+    }                                                                          \
+  } while (0)
+
+#else
+
+#define IPC_PROBE(name, a, b, c)                                               \
+  do {                                                                         \
+  } while (0)
+
+#endif
@@ -0,0 +1,231 @@
+// MIT License
+//
+// Copyright (c) 2025 [Janea Systems]
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// =============================================================================
+// Worker placement
+//
+// Where a spawned worker runs and where its memory lives:
+// - a CPU set, so producer and consumer stop migrating between cores
+// - a NUMA node its memory is bound to, typically the node of the GPU's PCIe
+//   root, so staging buffers and host slabs sit next to the device
+// - an optional low-latency profile: SCHED_FIFO for the calling thread and
+//   memory locked as it is faulted in
+//
+// Placement is applied by the worker itself, before it makes its first CUDA
+// call, so every thread it or the driver starts later inherits the CPU set
+// and memory policy. Finding the GPU's NUMA node therefore reads procfs and
+// sysfs instead of asking the CUDA runtime. SCHED_FIFO is set with
+// SCHED_RESET_ON_FORK so helper threads such as the driver's or the
+// reclaimer stay at normal priority.
+// =============================================================================
+
+#pragma once
+
+#include "ipc_protocol.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ipc {
+
+struct WorkerPlacement {
+  std::vector<int> cpus; // Empty leaves the inherited affinity alone
+  int numa_node = -1;    // Negative leaves the memory policy alone
+  int rt_priority = 0;   // Above 0 runs the calling thread SCHED_FIFO
+  bool lock_memory = false;
+
+  std::string describe() const {
+    std::ostringstream out;
+    out << "CPUs ";
+    if (cpus.empty()) {
+      out << "any";
+    }
+    for (size_t k = 0; k < cpus.size(); ++k) {
+      out << (k > 0 ? "," : "") << cpus[k];
+    }
+    out << ", NUMA node ";
+    if (numa_node < 0) {
+      out << "any";
+    } else {
+      out << numa_node;
+    }
+    if (rt_priority > 0) {
+      out << ", SCHED_FIFO " << rt_priority;
+    }
+    if (lock_memory) {
+      out << ", memory locked";
+    }
+    return out.str();
+  }
+};
+
+// Parses a kernel style CPU list such as "0-3,8,10-11".
+inline std::vector<int> parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    char *end = nullptr;
+    long first = strtol(range.c_str(), &end, 10);
+    long last = first;
+    if (*end == '-') {
+      last = strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+      throw std::runtime_error("Invalid CPU list: " + list);
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+// NUMA node of a PCI device given its bus id ("0000:3B:00.0"), or -1 when
+// the platform does not report one.
+inline int pciNumaNode(std::string bus_id) {
+  for (char &c : bus_id) {
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+  std::string node =
+      readFirstLine(("/sys/bus/pci/devices/" + bus_id + "/numa_node").c_str());
+  return node.empty() ? -1 : atoi(node.c_str());
+}
+
+// PCI bus id of the GPU the CUDA runtime will number device 0, worked out
+// from CUDA_VISIBLE_DEVICES and /proc/driver/nvidia/gpus so the driver is
+// not initialised before the placement is applied. A device picked by UUID
+// is always found; one picked by index only with CUDA_DEVICE_ORDER=PCI_BUS_ID
+// or a single GPU, since the runtime's default order ranks GPUs by speed.
+// Returns an empty string when the GPU cannot be told.
+inline std::string cudaDevice0BusId() {
+  const std::string root = "/proc/driver/nvidia/gpus";
+  std::vector<std::string> gpus; // PCI bus ids, in bus order
+  if (DIR *dir = opendir(root.c_str())) {
+    while (struct dirent *entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') {
+        gpus.push_back(entry->d_name);
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(gpus.begin(), gpus.end());
+  const char *visible = getenv("CUDA_VISIBLE_DEVICES");
+  std::string first = visible != nullptr ? visible : "0";
+  first = first.substr(0, first.find(','));
+  if (first.compare(0, 4, "GPU-") == 0) {
+    // UUIDs may be abbreviated to any unique prefix
+    for (const std::string &gpu : gpus) {
+      std::ifstream info(root + "/" + gpu + "/information");
+      std::string line;
+      while (std::getline(info, line)) {
+        const size_t at = line.find("GPU-");
+        if (line.compare(0, 8, "GPU UUID") == 0 && at != std::string::npos &&
+            line.compare(at, first.size(), first) == 0) {
+          return gpu;
+        }
+      }
+    }
+    return "";
+  }
+  char *end = nullptr;
+  const long index = strtol(first.c_str(), &end, 10);
+  const char *order = getenv("CUDA_DEVICE_ORDER");
+  const bool bus_order =
+      gpus.size() == 1 ||
+      (order != nullptr && strcmp(order, "PCI_BUS_ID") == 0);
+  if (first.empty() || *end != '\0' || index < 0 ||
+      static_cast<size_t>(index) >= gpus.size() || !bus_order) {
+    return "";
+  }
+  return gpus[index];
+}
+
+inline std::vector<int> numaNodeCpus(int node) {
+  std::string path =
+      "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+  return parseCpuList(readFirstLine(path.c_str()));
+}
+
+inline void applyPlacement(const WorkerPlacement &placement) {
+  if (!placement.cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : placement.cpus) {
+      CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      throw std::runtime_error(std::string("sched_setaffinity failed: ") +
+                               strerror(errno));
+    }
+  }
+  if (placement.numa_node >= 0) {
+    const unsigned long bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(placement.numa_node / bits + 1, 0);
+    mask[placement.numa_node / bits] |= 1ul << (placement.numa_node % bits);
+    if (syscall(SYS_set_mempolicy, MPOL_BIND, mask.data(),
+                mask.size() * bits + 1) != 0) {
+      throw std::runtime_error("Binding memory to NUMA node " +
+                               std::to_string(placement.numa_node) +
+                               " failed: " + strerror(errno));
+    }
+  }
+  if (placement.rt_priority > 0) {
+    struct sched_param param = {};
+    param.sched_priority = placement.rt_priority;
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) != 0) {
+      throw std::runtime_error(std::string("SCHED_FIFO failed: ") +
+                               strerror(errno));
+    }
+  }
+  // MCL_ONFAULT locks pages as they are touched instead of populating every
+  // future mapping, which the CUDA driver's large address space reservations
+  // would not survive
+  if (placement.lock_memory &&
+      mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) != 0) {
+    throw std::runtime_error(std::string("mlockall failed: ") +
+                             strerror(errno));
+  }
+}
+
+} // namespace ipc